@@ -0,0 +1,499 @@
+#include "chronos_app.hpp"
+#include "chronos_job_system.hpp"
+#include "chronos_staging_ring.hpp"
+#include "chronos_transform_batch.hpp"
+
+//libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+//std
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Renders scripted scenes headlessly for a fixed number of frames and writes the
+// results as JSON. The engine logs to stdout, so the report goes to a file.
+//
+//   chronos_bench [--frames N] [--warmup N] [--filter substring] [--shaders dir] [--out file]
+
+using namespace Chronos;
+using clock_type = std::chrono::steady_clock;
+
+namespace {
+
+struct Options {
+    uint32_t frames = 600;
+    uint32_t warmupFrames = 60;
+    std::string filter;
+    std::string shaderDirectory;
+    std::string outputPath = "chronos_bench.json";
+};
+
+struct Scene {
+    std::string name;
+    uint32_t objectCount;
+    uint32_t modelCount;
+    ChronosApp::RenderPath renderPath;
+    ChronosApp::ThreadingMode threadingMode;
+    uint32_t jobWorkers;
+    uint32_t trianglesPerModel = 1;
+    // draw from host-visible vertex buffers, as before the staging ring
+    bool hostVisibleVertices = false;
+};
+
+const char *renderPathName(ChronosApp::RenderPath path)
+{
+    switch (path) {
+        case ChronosApp::RenderPath::PerObject: return "per_object";
+        case ChronosApp::RenderPath::Instanced: return "instanced";
+        case ChronosApp::RenderPath::GpuDriven: return "gpu_driven";
+    }
+    return "unknown";
+}
+
+const char *threadingModeName(ChronosApp::ThreadingMode mode)
+{
+    return mode == ChronosApp::ThreadingMode::Pipelined ? "pipelined" : "single_threaded";
+}
+
+bool matchesFilter(const Options &options, const std::string &name)
+{
+    return options.filter.empty() || name.find(options.filter) != std::string::npos;
+}
+
+std::vector<Scene> buildSceneMatrix()
+{
+    const uint32_t defaultWorkers = ChronosJobSystem::defaultWorkerCount();
+    std::vector<uint32_t> workerCounts{0};
+    if (defaultWorkers > 0) {
+        workerCounts.push_back(defaultWorkers);
+    }
+
+    std::vector<Scene> scenes;
+    for (uint32_t objectCount : {1000u, 10000u}) {
+        for (uint32_t modelCount : {1u, 16u}) {
+            for (auto path : {ChronosApp::RenderPath::PerObject,
+                              ChronosApp::RenderPath::Instanced,
+                              ChronosApp::RenderPath::GpuDriven}) {
+                for (auto mode : {ChronosApp::ThreadingMode::SingleThreaded, ChronosApp::ThreadingMode::Pipelined}) {
+                    for (uint32_t workers : workerCounts) {
+                        std::ostringstream name;
+                        name << "objects_" << objectCount << "/models_" << modelCount << "/"
+                             << renderPathName(path) << "/" << threadingModeName(mode) << "/workers_" << workers;
+                        scenes.push_back({name.str(), objectCount, modelCount, path, mode, workers});
+                    }
+                }
+            }
+        }
+    }
+
+    // 100k single-triangle objects: draw call count and frame time per render path
+    for (auto path : {ChronosApp::RenderPath::PerObject,
+                      ChronosApp::RenderPath::Instanced,
+                      ChronosApp::RenderPath::GpuDriven}) {
+        std::ostringstream name;
+        name << "triangles_100000/models_16/" << renderPathName(path);
+        scenes.push_back({name.str(), 100000, 16, path, ChronosApp::ThreadingMode::Pipelined, defaultWorkers});
+    }
+
+    // parallel per-object recording against the number of job threads
+    std::vector<uint32_t> scalingWorkers{0};
+    for (uint32_t workers = 1; workers < defaultWorkers; workers *= 2) {
+        scalingWorkers.push_back(workers);
+    }
+    if (defaultWorkers > 0) {
+        scalingWorkers.push_back(defaultWorkers);
+    }
+    for (uint32_t workers : scalingWorkers) {
+        std::ostringstream name;
+        name << "thread_scaling/objects_10000/per_object/workers_" << workers;
+        scenes.push_back({name.str(), 10000, 16, ChronosApp::RenderPath::PerObject,
+                          ChronosApp::ThreadingMode::Pipelined, workers});
+    }
+
+    // vertex-heavy meshes, where vertex fetch bandwidth shows
+    for (bool hostVisible : {true, false}) {
+        std::ostringstream name;
+        name << "vertex_memory/" << (hostVisible ? "host_visible" : "device_local") << "/objects_1000/triangles_8192";
+        Scene scene{name.str(), 1000, 16, ChronosApp::RenderPath::PerObject, ChronosApp::ThreadingMode::Pipelined,
+                    defaultWorkers};
+        scene.trianglesPerModel = 8192;
+        scene.hostVisibleVertices = hostVisible;
+        scenes.push_back(scene);
+    }
+    return scenes;
+}
+
+// A square grid of about trianglesPerModel triangles covering [-.5, .5]; the
+// builder shares the vertices of neighbouring cells.
+ChronosModel::Builder gridModel(uint32_t trianglesPerModel, float skew)
+{
+    uint32_t cells = std::max(1u, static_cast<uint32_t>(std::sqrt(trianglesPerModel / 2.0)));
+    std::vector<ChronosModel::Vertex> triangleList;
+    triangleList.reserve(cells * cells * 6);
+    auto vertex = [&](uint32_t x, uint32_t y) {
+        float u = static_cast<float>(x) / cells;
+        float v = static_cast<float>(y) / cells;
+        return ChronosModel::Vertex{{u - .5f + skew * v * .1f, v - .5f}, {u, v, 1.f - v}};
+    };
+    for (uint32_t y = 0; y < cells; y++) {
+        for (uint32_t x = 0; x < cells; x++) {
+            triangleList.insert(triangleList.end(), {vertex(x, y), vertex(x + 1, y), vertex(x, y + 1)});
+            triangleList.insert(triangleList.end(), {vertex(x + 1, y), vertex(x + 1, y + 1), vertex(x, y + 1)});
+        }
+    }
+    ChronosModel::Builder builder{};
+    builder.loadVertices(triangleList);
+    return builder;
+}
+
+// Models are triangles of varying shape, or grids of them; transforms are fixed by
+// the seed so every run draws the same scene. One in eight objects spins.
+ChronosApp::Settings sceneSettings(const Scene &scene, const Options &options)
+{
+    ChronosApp::Settings settings{};
+    settings.headless = true;
+    // every measured frame has to use the path the row is labelled with
+    settings.waitForPipelines = true;
+    settings.renderPath = scene.renderPath;
+    settings.threadingMode = scene.threadingMode;
+    settings.jobWorkers = scene.jobWorkers;
+    if (!options.shaderDirectory.empty()) {
+        settings.shaderDirectory = options.shaderDirectory;
+    }
+
+    auto spinning = std::make_shared<std::vector<ChronosEntity>>();
+    settings.buildScene = [scene, spinning](
+            ChronosDevice &device, ChronosRegistry &registry, ChronosJobSystem &jobSystem) {
+        std::mt19937 random{1234};
+        std::uniform_real_distribution<float> unit{0.f, 1.f};
+
+        std::vector<std::function<ChronosModel::Builder()>> loaders;
+        for (uint32_t i = 0; i < scene.modelCount; i++) {
+            float skew = static_cast<float>(i) / static_cast<float>(scene.modelCount);
+            loaders.push_back([scene, skew]() {
+                ChronosModel::Builder builder{};
+                if (scene.trianglesPerModel > 1) {
+                    builder = gridModel(scene.trianglesPerModel, skew);
+                } else {
+                    builder.loadVertices({
+                        {{ skew - .5f, -0.5f}, {1.0f, 0.0f, 0.0f}},
+                        {{ 0.5f, 0.5f}, {0.0f, 1.0f, 0.0f}},
+                        {{-0.5f, 0.5f}, {0.0f, 0.0f, 1.0f}},
+                    });
+                }
+                builder.hostVisible = scene.hostVisibleVertices;
+                return builder;
+            });
+        }
+        auto models = ChronosModel::createModels(device, jobSystem, loaders);
+
+        for (uint32_t i = 0; i < scene.objectCount; i++) {
+            auto entity = registry.create();
+            registry.add<ModelComponent>(entity, {models[i % models.size()]});
+            registry.add<ColorComponent>(entity, {{unit(random), unit(random), unit(random)}});
+            auto &transform = registry.add<Transform2dComponent>(entity);
+            transform.translation = {unit(random) * 2.f - 1.f, unit(random) * 2.f - 1.f};
+            transform.scale = glm::vec2{.02f + .03f * unit(random)};
+            transform.rotation = unit(random) * glm::two_pi<float>();
+            if (i % 8 == 0) {
+                spinning->push_back(entity);
+            }
+        }
+    };
+    settings.updateScene = [spinning](ChronosRegistry &registry, float dt) {
+        for (ChronosEntity entity : *spinning) {
+            registry.patch<Transform2dComponent>(entity, [dt](Transform2dComponent &t) {
+                t.rotation = std::fmod(t.rotation + dt, glm::two_pi<float>());
+            });
+        }
+    };
+    return settings;
+}
+
+// nearest-rank percentile of sorted values
+double percentile(const std::vector<double> &sorted, double p)
+{
+    if (sorted.empty()) return 0.0;
+    size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * static_cast<double>(sorted.size())));
+    return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+}
+
+void writeSceneResult(std::ostream &out, const Scene &scene, const Options &options)
+{
+    ChronosApp app{sceneSettings(scene, options)};
+    // one call, since the simulation can only be started once per app
+    auto samples = app.runFrames(options.warmupFrames + options.frames);
+    samples.erase(samples.begin(), samples.begin() + std::min<size_t>(options.warmupFrames, samples.size()));
+    ChronosAllocatorStats memory = app.getDevice().getAllocatorStats();
+
+    std::vector<double> cpu;
+    std::vector<double> latency;
+    double cpuTotal = 0.0;
+    double recordTotal = 0.0;
+    double gpuTotal = 0.0;
+    uint32_t gpuSamples = 0;
+    uint64_t drawCallTotal = 0;
+    uint32_t fallbackFrames = 0;
+    for (const auto &sample : samples) {
+        if (sample.renderPath != scene.renderPath) {
+            fallbackFrames++;
+        }
+        cpu.push_back(sample.cpuMilliseconds);
+        cpuTotal += sample.cpuMilliseconds;
+        recordTotal += sample.recordMilliseconds;
+        if (sample.gpuMilliseconds >= 0.0) {
+            gpuTotal += sample.gpuMilliseconds;
+            gpuSamples++;
+        }
+        drawCallTotal += sample.drawCalls;
+        if (sample.latencyMilliseconds >= 0.0) {
+            latency.push_back(sample.latencyMilliseconds);
+        }
+    }
+    std::sort(cpu.begin(), cpu.end());
+    std::sort(latency.begin(), latency.end());
+    double frameCount = samples.empty() ? 1.0 : static_cast<double>(samples.size());
+
+    out << "    {\"name\": \"" << scene.name << "\""
+        << ", \"objects\": " << scene.objectCount
+        << ", \"models\": " << scene.modelCount
+        << ", \"triangles_per_model\": " << scene.trianglesPerModel
+        << ", \"vertex_memory\": \"" << (scene.hostVisibleVertices ? "host_visible" : "device_local") << "\""
+        << ", \"render_path\": \"" << renderPathName(scene.renderPath) << "\""
+        << ", \"threading\": \"" << threadingModeName(scene.threadingMode) << "\""
+        << ", \"job_threads\": " << scene.jobWorkers + 1
+        << ", \"frames\": " << samples.size()
+        << ", \"fallback_frames\": " << fallbackFrames
+        << ",\n     \"cpu_ms\": {\"p50\": " << percentile(cpu, 50) << ", \"p95\": " << percentile(cpu, 95)
+        << ", \"p99\": " << percentile(cpu, 99) << ", \"max\": " << (cpu.empty() ? 0.0 : cpu.back()) << "}"
+        << ", \"record_ms_avg\": " << recordTotal / frameCount
+        << ", \"gpu_ms_avg\": ";
+    if (gpuSamples > 0) {
+        out << gpuTotal / gpuSamples;
+    } else {
+        out << "null";
+    }
+    // simulation start to present, once per simulated snapshot
+    out << ", \"latency_ms\": ";
+    if (!latency.empty()) {
+        out << "{\"p50\": " << percentile(latency, 50) << ", \"p95\": " << percentile(latency, 95)
+            << ", \"max\": " << latency.back() << "}";
+    } else {
+        out << "null";
+    }
+    out << ", \"draw_calls_avg\": " << static_cast<double>(drawCallTotal) / frameCount
+        << ", \"draws_per_sec\": " << (cpuTotal > 0.0 ? drawCallTotal * 1000.0 / cpuTotal : 0.0)
+        << ",\n     \"memory\": {\"used_bytes\": " << memory.usedBytes
+        << ", \"reserved_bytes\": " << memory.reservedBytes
+        << ", \"blocks\": " << memory.blockCount
+        << ", \"allocations\": " << memory.allocationCount << "}}";
+}
+
+// Model upload throughput: writing vertices straight into host-visible memory
+// against staging them into device-local memory, until the GPU can draw them.
+void writeUploadResults(std::ostream &out)
+{
+    constexpr VkDeviceSize BYTES_PER_RUN = 64ull * 1024 * 1024;
+    ChronosDevice device{};
+
+    bool first = true;
+    for (VkDeviceSize modelBytes : {VkDeviceSize{4 * 1024}, VkDeviceSize{256 * 1024}, VkDeviceSize{4 * 1024 * 1024}}) {
+        ChronosModel::Builder builder{};
+        builder.vertices.resize(modelBytes / sizeof(ChronosModel::Vertex));
+        for (size_t i = 0; i < builder.vertices.size(); i++) {
+            builder.vertices[i] = {{static_cast<float>(i % 3), static_cast<float>(i % 5)}, {1.f, 1.f, 1.f}};
+        }
+        uint32_t modelCount = static_cast<uint32_t>(BYTES_PER_RUN / modelBytes);
+
+        for (bool hostVisible : {true, false}) {
+            builder.hostVisible = hostVisible;
+            std::vector<std::unique_ptr<ChronosModel>> models;
+            models.reserve(modelCount);
+
+            auto start = clock_type::now();
+            for (uint32_t i = 0; i < modelCount; i++) {
+                models.push_back(std::make_unique<ChronosModel>(device, builder));
+            }
+            device.stagingRing().flush();
+            device.stagingRing().waitIdle();
+            std::chrono::duration<double> elapsed = clock_type::now() - start;
+
+            out << (first ? "" : ",\n") << "    {\"vertex_memory\": \""
+                << (hostVisible ? "host_visible" : "device_local") << "\""
+                << ", \"model_bytes\": " << modelBytes
+                << ", \"models\": " << modelCount
+                << ", \"mb_per_sec\": " << BYTES_PER_RUN / (1024.0 * 1024.0) / elapsed.count() << "}";
+            first = false;
+        }
+    }
+}
+
+// Sweeps from cache-resident to DRAM-bound batch sizes; each run converts about the
+// same number of transforms so small batches are not dominated by timer noise.
+void writeTransformResults(std::ostream &out)
+{
+    constexpr size_t TRANSFORMS_PER_RUN = 1 << 24;
+
+    bool first = true;
+    for (size_t count : {10'000u, 100'000u, 1'000'000u, 10'000'000u}) {
+        std::vector<Transform2dComponent> transforms(count);
+        std::vector<glm::mat2> matrices(count);
+        for (size_t i = 0; i < count; i++) {
+            transforms[i].rotation = static_cast<float>(i) * .001f;
+            transforms[i].scale = {1.f + static_cast<float>(i % 7), 1.f};
+        }
+
+        size_t repeats = std::max<size_t>(1, TRANSFORMS_PER_RUN / count);
+        for (auto level : {ChronosSimdLevel::Scalar, ChronosSimdLevel::SSE2, ChronosSimdLevel::AVX2}) {
+            if (level > detectSimdLevel()) continue;
+            computeTransformMatrices(level, transforms.data(), matrices.data(), count);
+            auto start = clock_type::now();
+            for (size_t i = 0; i < repeats; i++) {
+                computeTransformMatrices(level, transforms.data(), matrices.data(), count);
+            }
+            std::chrono::duration<double> elapsed = clock_type::now() - start;
+            out << (first ? "" : ",\n") << "    {\"simd\": \"" << simdLevelName(level) << "\", \"count\": " << count
+                << ", \"transforms_per_sec\": " << static_cast<double>(count) * repeats / elapsed.count() << "}";
+            first = false;
+        }
+    }
+}
+
+void writeJobSystemResults(std::ostream &out)
+{
+    constexpr uint32_t JOBS = 100000;
+    constexpr size_t ELEMENTS = 1 << 22;
+    std::vector<float> values(ELEMENTS, 2.f);
+    double baselineMilliseconds = 0.0;
+
+    std::vector<uint32_t> workerCounts{0};
+    for (uint32_t workers = 1; workers < ChronosJobSystem::defaultWorkerCount(); workers *= 2) {
+        workerCounts.push_back(workers);
+    }
+    if (ChronosJobSystem::defaultWorkerCount() > 0) {
+        workerCounts.push_back(ChronosJobSystem::defaultWorkerCount());
+    }
+
+    bool first = true;
+    for (uint32_t workers : workerCounts) {
+        ChronosJobSystem jobSystem{workers};
+
+        std::atomic<uint32_t> ran{0};
+        ChronosJobCounter counter;
+        auto start = clock_type::now();
+        for (uint32_t i = 0; i < JOBS; i++) {
+            jobSystem.run([&ran]() { ran.fetch_add(1, std::memory_order_relaxed); }, &counter);
+        }
+        jobSystem.wait(counter);
+        std::chrono::duration<double, std::nano> jobTime = clock_type::now() - start;
+
+        std::vector<double> partialSums(ELEMENTS / 4096 + 1, 0.0);
+        start = clock_type::now();
+        jobSystem.parallelFor(0, ELEMENTS, 4096, [&](size_t begin, size_t end) {
+            double sum = 0.0;
+            for (size_t i = begin; i < end; i++) {
+                sum += std::sqrt(values[i]);
+            }
+            partialSums[begin / 4096] = sum;
+        });
+        std::chrono::duration<double, std::milli> forTime = clock_type::now() - start;
+        if (workers == 0) {
+            baselineMilliseconds = forTime.count();
+        }
+
+        out << (first ? "" : ",\n") << "    {\"threads\": " << jobSystem.getThreadCount()
+            << ", \"ns_per_job\": " << jobTime.count() / JOBS
+            << ", \"parallel_for_ms\": " << forTime.count()
+            << ", \"parallel_for_speedup\": " << baselineMilliseconds / forTime.count() << "}";
+        first = false;
+    }
+}
+
+Options parseOptions(int argc, char **argv)
+{
+    Options options{};
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            throw std::runtime_error("missing value for " + arg + "!");
+        }
+        std::string value = argv[++i];
+        if (arg == "--frames") {
+            options.frames = static_cast<uint32_t>(std::stoul(value));
+        } else if (arg == "--warmup") {
+            options.warmupFrames = static_cast<uint32_t>(std::stoul(value));
+        } else if (arg == "--filter") {
+            options.filter = value;
+        } else if (arg == "--shaders") {
+            options.shaderDirectory = value;
+        } else if (arg == "--out") {
+            options.outputPath = value;
+        } else {
+            throw std::runtime_error("unknown option " + arg + "!");
+        }
+    }
+    return options;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    try {
+        Options options = parseOptions(argc, argv);
+        std::ofstream out{options.outputPath};
+        if (!out) {
+            throw std::runtime_error("failed to open " + options.outputPath + "!");
+        }
+
+        out << "{\n  \"frames\": " << options.frames << ",\n  \"scenes\": [\n";
+        bool first = true;
+        for (const auto &scene : buildSceneMatrix()) {
+            if (!matchesFilter(options, scene.name)) continue;
+            std::cerr << "bench: " << scene.name << std::endl;
+            out << (first ? "" : ",\n");
+            writeSceneResult(out, scene, options);
+            first = false;
+        }
+        out << "\n  ]";
+
+        if (matchesFilter(options, "uploads")) {
+            out << ",\n  \"uploads\": [\n";
+            writeUploadResults(out);
+            out << "\n  ]";
+        }
+        if (matchesFilter(options, "transforms")) {
+            out << ",\n  \"transforms\": [\n";
+            writeTransformResults(out);
+            out << "\n  ]";
+        }
+        if (matchesFilter(options, "jobs")) {
+            out << ",\n  \"jobs\": [\n";
+            writeJobSystemResults(out);
+            out << "\n  ]";
+        }
+        out << "\n}\n";
+        std::cerr << "bench: wrote " << options.outputPath << std::endl;
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,674 @@
+#include "chronos_app.hpp"
+#include "chronos_job_system.hpp"
+#include "chronos_offscreen_target.hpp"
+#include "chronos_pipeline_layout_cache.hpp"
+#include "chronos_pipeline_registry.hpp"
+#include "chronos_shader_library.hpp"
+#include "chronos_transform_batch.hpp"
+#include "chronos_transform_hierarchy.hpp"
+
+//libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+//std
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Behaviour checks for engine subsystems, checked against simple serial or CPU
+// references. GPU checks render headlessly and are skipped when no Vulkan device
+// is available (lavapipe is enough). Exits nonzero if any check fails.
+//
+//   chronos_selfcheck [--shaders dir]
+
+using namespace Chronos;
+
+namespace {
+
+struct Options {
+    std::string shaderDirectory;
+};
+
+uint32_t failures = 0;
+
+void check(bool condition, const char *expression, const char *file, int line)
+{
+    if (!condition) {
+        failures++;
+        std::cerr << file << ":" << line << ": check failed: " << expression << std::endl;
+    }
+}
+
+#define CHECK(condition) check((condition), #condition, __FILE__, __LINE__)
+
+bool hasVulkanDevice()
+{
+    try {
+        ChronosDevice device{};
+        return true;
+    } catch (const std::exception &e) {
+        std::cerr << "selfcheck: no Vulkan device (" << e.what() << ")" << std::endl;
+        return false;
+    }
+}
+
+ChronosApp::Settings headlessSettings(const Options &options, ChronosApp::RenderPath renderPath)
+{
+    ChronosApp::Settings settings{};
+    settings.headless = true;
+    // otherwise early frames draw per object while the instanced pipeline compiles
+    settings.waitForPipelines = true;
+    settings.renderPath = renderPath;
+    settings.threadingMode = ChronosApp::ThreadingMode::SingleThreaded;
+    if (!options.shaderDirectory.empty()) {
+        settings.shaderDirectory = options.shaderDirectory;
+    }
+    return settings;
+}
+
+bool nearlyEqual(float a, float b)
+{
+    return std::abs(a - b) <= 1e-3f * std::max(1.f, std::abs(b));
+}
+
+bool nearlyEqual(const glm::mat2 &a, const glm::mat2 &b)
+{
+    return nearlyEqual(a[0][0], b[0][0]) && nearlyEqual(a[0][1], b[0][1]) && nearlyEqual(a[1][0], b[1][0]) &&
+           nearlyEqual(a[1][1], b[1][1]);
+}
+
+// Every kernel the CPU supports against the component's own mat2(), over negative
+// angles, angles many turns out and counts that leave a scalar tail after the 4- and
+// 8-wide loops.
+void checkTransformKernels(const Options &)
+{
+    std::mt19937 random{7};
+    std::uniform_real_distribution<float> angle{-8000.f, 8000.f};
+    std::uniform_real_distribution<float> scale{-4.f, 4.f};
+    std::vector<Transform2dComponent> transforms;
+    for (float rotation : {0.f, -0.f, 1e-6f, -1e-6f, .785398f, -.785398f, 1.570796f, -3.141593f, 6.283185f,
+                           -6.283185f, 12.5f, -100.25f, 1000.f, -4096.5f, 8000.f}) {
+        transforms.push_back({{}, {1.f, -2.f}, rotation});
+    }
+    while (transforms.size() < 1000) {
+        transforms.push_back({{}, {scale(random), scale(random)}, angle(random)});
+    }
+
+    auto highest = static_cast<int>(detectSimdLevel());
+    for (int level = 0; level <= highest; level++) {
+        for (size_t count : {1, 3, 4, 5, 7, 8, 9, 13, 15, 16, 17, 1000}) {
+            // a guard past the end catches a kernel writing beyond count
+            std::vector<glm::mat2> out(count + 1, glm::mat2{7.f});
+            computeTransformMatrices(static_cast<ChronosSimdLevel>(level), transforms.data(), out.data(), count);
+            size_t mismatches = 0;
+            for (size_t i = 0; i < count; i++) {
+                glm::mat2 expected = transforms[i].mat2();
+                float tolerance = 4e-6f * std::max(std::abs(transforms[i].scale.x), std::abs(transforms[i].scale.y));
+                for (int c = 0; c < 2; c++) {
+                    for (int r = 0; r < 2; r++) {
+                        if (!(std::abs(out[i][c][r] - expected[c][r]) <= tolerance)) {
+                            mismatches++;
+                        }
+                    }
+                }
+            }
+            CHECK(mismatches == 0);
+            CHECK(out[count] == glm::mat2{7.f});
+            if (mismatches != 0) {
+                std::cerr << "selfcheck: " << simdLevelName(static_cast<ChronosSimdLevel>(level)) << " kernel, "
+                          << count << " transforms: " << mismatches << " values out of tolerance" << std::endl;
+            }
+        }
+    }
+}
+
+struct WorldTransform {
+    glm::mat2 matrix;
+    glm::vec2 offset;
+};
+
+// walks the parent chain with the component's own mat2()
+WorldTransform referenceWorld(ChronosRegistry &registry, ChronosEntity entity)
+{
+    auto &transforms = registry.pool<Transform2dComponent>();
+    const Transform2dComponent &transform = *transforms.find(entity);
+    WorldTransform world{transform.mat2(), transform.translation};
+    ParentComponent *parent = registry.pool<ParentComponent>().find(entity);
+    if (parent && transforms.find(parent->parent)) {
+        WorldTransform up = referenceWorld(registry, parent->parent);
+        world = {up.matrix * world.matrix, up.matrix * transform.translation + up.offset};
+    }
+    return world;
+}
+
+// counts transforms whose propagated world transform differs from the serial reference
+size_t countMismatches(ChronosRegistry &registry, const ChronosTransformHierarchy &hierarchy)
+{
+    auto &transforms = registry.pool<Transform2dComponent>();
+    size_t mismatches = 0;
+    for (size_t i = 0; i < transforms.size(); i++) {
+        WorldTransform expected = referenceWorld(registry, transforms.entityAt(i));
+        const glm::vec2 &offset = hierarchy.worldOffset(i);
+        if (!nearlyEqual(hierarchy.worldMatrix(i), expected.matrix) || !nearlyEqual(offset.x, expected.offset.x) ||
+            !nearlyEqual(offset.y, expected.offset.y)) {
+            mismatches++;
+        }
+    }
+    return mismatches;
+}
+
+void checkHierarchy(const Options &)
+{
+    // a two-node cycle has no root, so it can never be ordered
+    {
+        ChronosRegistry registry;
+        ChronosEntity a = registry.create();
+        ChronosEntity b = registry.create();
+        registry.add<Transform2dComponent>(a);
+        registry.add<Transform2dComponent>(b);
+        registry.add<ParentComponent>(a, {b});
+        registry.add<ParentComponent>(b, {a});
+        ChronosTransformHierarchy hierarchy;
+        auto rejects = [&]() {
+            try {
+                hierarchy.update(registry);
+            } catch (const std::runtime_error &) {
+                return true;
+            }
+            return false;
+        };
+        CHECK(rejects());
+        // consumed dirty lists must not let a later update use the half-built order
+        registry.clearDirty();
+        CHECK(rejects());
+
+        // breaking the cycle builds normally again
+        registry.remove<ParentComponent>(b);
+        hierarchy.update(registry);
+        CHECK(hierarchy.size() == 2);
+        CHECK(hierarchy.levelCount() == 2);
+    }
+
+    // a random forest hanging off its first 16 nodes, so its middle levels are wide enough
+    // to be split across the job system
+    ChronosJobSystem jobSystem{4};
+    ChronosTransformHierarchy hierarchy;
+    hierarchy.setParallelFor(
+            [&jobSystem](size_t begin, size_t end, size_t grainSize, const ChronosJobSystem::RangeFunction &body) {
+                jobSystem.parallelFor(begin, end, grainSize, body);
+            });
+
+    ChronosRegistry registry;
+    std::mt19937 random{42};
+    std::uniform_real_distribution<float> unit{0.f, 1.f};
+    std::vector<ChronosEntity> entities;
+    for (uint32_t i = 0; i < 20000; i++) {
+        ChronosEntity entity = registry.create();
+        auto &transform = registry.add<Transform2dComponent>(entity);
+        transform.translation = {unit(random) * 2.f - 1.f, unit(random) * 2.f - 1.f};
+        transform.scale = {.8f + .4f * unit(random), .8f + .4f * unit(random)};
+        transform.rotation = unit(random) * 6.28f;
+        if (!entities.empty() && unit(random) < .9f) {
+            registry.add<ParentComponent>(entity, {entities[random() % std::min<size_t>(entities.size(), 16)]});
+        }
+        entities.push_back(entity);
+    }
+
+    hierarchy.update(registry);
+    CHECK(hierarchy.size() == entities.size());
+    CHECK(hierarchy.levelCount() > 1);
+    CHECK(countMismatches(registry, hierarchy) == 0);
+
+    // a few moved transforms, the first of them a hub, take the incremental path, which
+    // must still reach every descendant
+    registry.clearDirty();
+    for (uint32_t i = 0; i < 16; i++) {
+        registry.patch<Transform2dComponent>(entities[i * 97], [](Transform2dComponent &t) {
+            t.rotation += .5f;
+            t.translation.x += .25f;
+        });
+    }
+    hierarchy.update(registry);
+    CHECK(countMismatches(registry, hierarchy) == 0);
+
+    // reparenting rebuilds the order
+    registry.clearDirty();
+    registry.patch<ParentComponent>(entities[500], [&](ParentComponent &p) { p.parent = entities[0]; });
+    hierarchy.update(registry);
+    CHECK(countMismatches(registry, hierarchy) == 0);
+}
+
+// every index of [0, count) must be visited exactly once, in chunks of at most grainSize
+// unless the whole range ran inline
+bool coversRange(ChronosJobSystem &jobSystem, size_t count, size_t grainSize)
+{
+    std::vector<std::atomic<uint32_t>> visits(count);
+    std::atomic<bool> badChunk{false};
+    jobSystem.parallelFor(0, count, grainSize, [&](size_t begin, size_t end) {
+        bool wholeRange = begin == 0 && end == count;
+        if (begin >= end || end > count || (end - begin > grainSize && !wholeRange)) {
+            badChunk = true;
+            return;
+        }
+        for (size_t i = begin; i < end; i++) {
+            visits[i].fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+    return !badChunk && std::all_of(visits.begin(), visits.end(), [](const auto &v) { return v.load() == 1; });
+}
+
+void checkJobSystem(const Options &)
+{
+    ChronosJobSystem jobSystem{4};
+
+    // wait() returns only once every job attached to the counter has finished
+    {
+        std::atomic<uint32_t> finished{0};
+        ChronosJobCounter counter;
+        for (uint32_t i = 0; i < 1000; i++) {
+            jobSystem.run([&finished]() { finished.fetch_add(1); }, &counter);
+        }
+        jobSystem.wait(counter);
+        CHECK(counter.isDone());
+        CHECK(finished.load() == 1000);
+    }
+
+    // continuations start only after their dependency drops to zero, or right away if it already has
+    {
+        std::atomic<uint32_t> firstStage{0};
+        std::atomic<bool> startedEarly{false};
+        ChronosJobCounter first;
+        ChronosJobCounter second;
+        for (uint32_t i = 0; i < 64; i++) {
+            jobSystem.run([&firstStage]() {
+                std::this_thread::sleep_for(std::chrono::microseconds{100});
+                firstStage.fetch_add(1);
+            }, &first);
+        }
+        for (uint32_t i = 0; i < 64; i++) {
+            jobSystem.runAfter(first, [&]() {
+                if (firstStage.load() != 64) startedEarly = true;
+            }, &second);
+        }
+        jobSystem.wait(second);
+        CHECK(first.isDone());
+        CHECK(!startedEarly);
+
+        std::atomic<bool> ranLate{false};
+        jobSystem.runAfter(first, [&ranLate]() { ranLate = true; }, &second);
+        jobSystem.wait(second);
+        CHECK(ranLate);
+    }
+
+    // a job waiting on its own children keeps running jobs instead of deadlocking
+    {
+        std::atomic<uint32_t> innerJobs{0};
+        ChronosJobCounter outer;
+        for (uint32_t i = 0; i < 8; i++) {
+            jobSystem.run([&]() {
+                ChronosJobCounter inner;
+                for (uint32_t j = 0; j < 16; j++) {
+                    jobSystem.run([&innerJobs]() { innerJobs.fetch_add(1); }, &inner);
+                }
+                jobSystem.wait(inner);
+            }, &outer);
+        }
+        jobSystem.wait(outer);
+        CHECK(innerJobs.load() == 128);
+    }
+
+    // grain sizes that do and do not divide the range, and one larger than it
+    for (size_t grainSize : {1, 7, 64, 1000, 5000}) {
+        CHECK(coversRange(jobSystem, 4099, grainSize));
+    }
+    ChronosJobSystem inlineOnly{0};
+    CHECK(coversRange(inlineOnly, 4099, 64));
+
+    // two outside threads, like the render and simulation threads, waiting at the same time
+    {
+        std::atomic<bool> covered[2] = {{false}, {false}};
+        std::thread other{[&]() { covered[1] = coversRange(jobSystem, 100000, 64); }};
+        covered[0] = coversRange(jobSystem, 100000, 64);
+        other.join();
+        CHECK(covered[0] && covered[1]);
+    }
+
+    // chunks queued from inside a job are picked up by the other threads
+    {
+        std::mutex mutex;
+        std::set<std::thread::id> threads;
+        ChronosJobCounter counter;
+        jobSystem.run([&]() {
+            jobSystem.parallelFor(0, 64, 1, [&](size_t, size_t) {
+                std::this_thread::sleep_for(std::chrono::milliseconds{1});
+                std::lock_guard<std::mutex> lock{mutex};
+                threads.insert(std::this_thread::get_id());
+            });
+        }, &counter);
+        jobSystem.wait(counter);
+        CHECK(threads.size() > 1);
+    }
+}
+
+struct CullObject {
+    glm::vec2 translation;
+    float scale;
+    float rotation;
+};
+
+// A grid of small triangles that never overlap, so draw order cannot change the
+// image, plus objects straddling the viewport edge and objects well outside it.
+// Every other object uses a model without indices.
+std::vector<CullObject> cullScene()
+{
+    std::vector<CullObject> objects;
+    for (int y = 0; y < 8; y++) {
+        for (int x = 0; x < 8; x++) {
+            objects.push_back({{-.875f + .25f * x, -.875f + .25f * y}, .08f, .3f * (x + y)});
+        }
+    }
+    for (float edge : {-1.f, 1.f}) {
+        objects.push_back({{edge, .1f}, .08f, 0.f});
+        objects.push_back({{.1f, edge}, .08f, 1.f});
+    }
+    for (float far : {-3.f, 3.f}) {
+        objects.push_back({{far, 0.f}, .08f, 0.f});
+        objects.push_back({{0.f, far}, .08f, 0.f});
+        objects.push_back({{far, far}, .5f, 2.f});
+    }
+    return objects;
+}
+
+// the bounding circle test from cull.comp
+uint32_t expectedVisible(const std::vector<CullObject> &objects, float boundingRadius)
+{
+    uint32_t visible = 0;
+    for (const auto &object : objects) {
+        Transform2dComponent transform{object.translation, glm::vec2{object.scale}, object.rotation};
+        glm::mat2 m = transform.mat2();
+        float radius = boundingRadius * std::max(glm::length(m[0]), glm::length(m[1]));
+        if (std::abs(object.translation.x) <= 1.f + radius && std::abs(object.translation.y) <= 1.f + radius) {
+            visible++;
+        }
+    }
+    return visible;
+}
+
+struct CullRun {
+    std::vector<uint8_t> image;
+    ChronosGpuCulling::Stats stats;
+    std::vector<ChronosApp::FrameSample> samples;
+    float boundingRadius = 0.f;
+};
+
+bool drewWith(const std::vector<ChronosApp::FrameSample> &samples, ChronosApp::RenderPath renderPath)
+{
+    return !samples.empty() && std::all_of(samples.begin(), samples.end(), [renderPath](const auto &sample) {
+        return sample.renderPath == renderPath;
+    });
+}
+
+CullRun renderCullScene(const Options &options, ChronosApp::RenderPath renderPath)
+{
+    auto settings = headlessSettings(options, renderPath);
+    auto boundingRadius = std::make_shared<float>(0.f);
+    settings.buildScene = [boundingRadius](ChronosDevice &device, ChronosRegistry &registry, ChronosJobSystem &) {
+        ChronosModel::Builder builder{};
+        builder.loadVertices({
+            {{0.0f, -0.5f}, {1.0f, 0.0f, 0.0f}},
+            {{0.5f, 0.5f}, {0.0f, 1.0f, 0.0f}},
+            {{-0.5f, 0.5f}, {0.0f, 0.0f, 1.0f}},
+        });
+        auto indexed = std::make_shared<ChronosModel>(device, builder);
+        builder.indices.clear();
+        auto unindexed = std::make_shared<ChronosModel>(device, builder);
+        *boundingRadius = indexed->getBoundingRadius();
+        auto objects = cullScene();
+        for (size_t i = 0; i < objects.size(); i++) {
+            const auto &object = objects[i];
+            auto entity = registry.create();
+            registry.add<ModelComponent>(entity, {i % 2 == 0 ? indexed : unindexed});
+            registry.add<ColorComponent>(entity, {{.2f, .6f, .9f}});
+            auto &transform = registry.add<Transform2dComponent>(entity);
+            transform.translation = object.translation;
+            transform.scale = glm::vec2{object.scale};
+            transform.rotation = object.rotation;
+        }
+    };
+
+    ChronosApp app{settings};
+    CullRun run{};
+    // enough frames for the model upload to land and a culled frame to finish
+    run.samples = app.runFrames(16);
+    run.image = app.getRenderer().getOffscreenTarget().readLastFrame();
+    run.stats = app.getCullingStats();
+    run.boundingRadius = *boundingRadius;
+    return run;
+}
+
+void checkGpuCulling(const Options &options)
+{
+    CullRun gpuDriven = renderCullScene(options, ChronosApp::RenderPath::GpuDriven);
+    CullRun perObject = renderCullScene(options, ChronosApp::RenderPath::PerObject);
+
+    auto objects = cullScene();
+    uint32_t visible = expectedVisible(objects, gpuDriven.boundingRadius);
+    CHECK(drewWith(gpuDriven.samples, ChronosApp::RenderPath::GpuDriven));
+    CHECK(drewWith(perObject.samples, ChronosApp::RenderPath::PerObject));
+    // one indirect draw per model, one indexed and one not, however many objects share them
+    CHECK(!gpuDriven.samples.empty() && gpuDriven.samples.back().drawCalls == 2);
+    CHECK(gpuDriven.stats.objectCount == objects.size());
+    CHECK(gpuDriven.stats.visibleCount == visible);
+    CHECK(gpuDriven.stats.culledCount == objects.size() - visible);
+    std::cerr << "selfcheck: culling " << gpuDriven.stats.visibleCount << " visible, " << gpuDriven.stats.culledCount
+              << " culled of " << gpuDriven.stats.objectCount << " (expected " << visible << " visible)" << std::endl;
+
+    // culling must not drop anything the per-object path draws
+    CHECK(!gpuDriven.image.empty());
+    CHECK(gpuDriven.image.size() == perObject.image.size());
+    if (gpuDriven.image.size() == perObject.image.size()) {
+        size_t differing = 0;
+        for (size_t i = 0; i < gpuDriven.image.size(); i += 4) {
+            for (size_t c = 0; c < 4; c++) {
+                if (std::abs(gpuDriven.image[i + c] - perObject.image[i + c]) > 1) {
+                    differing++;
+                    break;
+                }
+            }
+        }
+        // allow for rasterization differences on a handful of edge pixels
+        CHECK(differing <= gpuDriven.image.size() / 4 / 1000);
+    }
+}
+
+void checkPipelineRegistry(const Options &options)
+{
+    std::string shaderDirectory =
+            options.shaderDirectory.empty() ? ChronosApp::Settings{}.shaderDirectory : options.shaderDirectory;
+    std::string vert = shaderDirectory + "simple_shader.vert.spv";
+    std::string frag = shaderDirectory + "simple_shader.frag.spv";
+
+    ChronosDevice device{};
+    ChronosOffscreenTarget target{device, {64, 64}, 1};
+    ChronosShaderLibrary shaderLibrary{device};
+    ChronosPipelineLayoutCache layoutCache{device};
+    ChronosPipelineRegistry registry{device, shaderLibrary};
+
+    auto vertModule = shaderLibrary.loadModule(vert);
+    auto fragModule = shaderLibrary.loadModule(frag);
+    VkPipelineLayout layout = layoutCache.getLayout({&vertModule->getReflection(), &fragModule->getReflection()});
+    auto configure = [&](PipelineConfigInfo &configInfo) {
+        ChronosPipeline::defaultPipelineConfigInfo(configInfo);
+        configInfo.renderPass = target.getRenderPass();
+        configInfo.pipelineLayout = layout;
+    };
+
+    // separately built but equal configs share one pipeline
+    PipelineConfigInfo config{};
+    configure(config);
+    PipelineConfigInfo equalConfig{};
+    configure(equalConfig);
+    auto first = registry.getPipeline(vert, frag, config);
+    auto second = registry.getPipeline(vert, frag, equalConfig);
+    CHECK(first && first == second);
+    auto stats = registry.getStats();
+    CHECK(stats.misses == 1 && stats.hits == 1 && stats.pipelineCount == 1);
+
+    // any fixed-function difference is a miss
+    PipelineConfigInfo culledConfig{};
+    configure(culledConfig);
+    culledConfig.rasterizationInfo.cullMode = VK_CULL_MODE_BACK_BIT;
+    auto culled = registry.getPipeline(vert, frag, culledConfig);
+    CHECK(culled && culled != first);
+    stats = registry.getStats();
+    CHECK(stats.misses == 2 && stats.hits == 1 && stats.pipelineCount == 2);
+
+    // a background request for a built pipeline hits without compiling
+    auto requested = registry.requestPipeline(vert, frag, equalConfig);
+    CHECK(ChronosPipelineRegistry::isReady(requested) && requested.get() == first);
+    CHECK(registry.getStats().hits == 2);
+
+    // only pipelines no caller holds are released, and a released one is built again
+    culled.reset();
+    CHECK(registry.releaseUnused() == 1);
+    CHECK(registry.getStats().pipelineCount == 1);
+    first.reset();
+    second.reset();
+    CHECK(registry.releaseUnused() == 1);
+    CHECK(registry.getStats().pipelineCount == 0);
+    auto rebuilt = registry.getPipeline(vert, frag, config);
+    CHECK(rebuilt && registry.getStats().misses == 3);
+}
+
+// 8-bit sRGB encoding of a linear channel, as the B8G8R8A8_SRGB target stores it
+int srgbByte(float linear)
+{
+    float encoded = linear <= .0031308f ? linear * 12.92f : 1.055f * std::pow(linear, 1.f / 2.4f) - .055f;
+    return static_cast<int>(std::lround(encoded * 255.f));
+}
+
+// A flat-coloured square over the middle half of a 64x64 target. No pixel centre
+// lies on its edges, so the golden image is exact: the square's colour on pixels
+// 16..47 in both axes and the clear colour everywhere else.
+void checkGoldenImage(const Options &options)
+{
+    constexpr uint32_t SIZE = 64;
+    const glm::vec3 color{1.f, .5f, 0.f};
+    const glm::vec3 clearColor{.01f, .01f, .01f};
+
+    for (auto path : {ChronosApp::RenderPath::PerObject,
+                      ChronosApp::RenderPath::Instanced,
+                      ChronosApp::RenderPath::GpuDriven}) {
+        auto settings = headlessSettings(options, path);
+        settings.extent = {SIZE, SIZE};
+        settings.buildScene = [color](ChronosDevice &device, ChronosRegistry &registry, ChronosJobSystem &) {
+            ChronosModel::Builder builder{};
+            builder.loadVertices({
+                {{-.5f, -.5f}, {}}, {{.5f, -.5f}, {}}, {{.5f, .5f}, {}},
+                {{-.5f, -.5f}, {}}, {{.5f, .5f}, {}}, {{-.5f, .5f}, {}},
+            });
+            auto entity = registry.create();
+            registry.add<ModelComponent>(entity, {std::make_shared<ChronosModel>(device, builder)});
+            registry.add<ColorComponent>(entity, {color});
+            registry.add<Transform2dComponent>(entity);
+        };
+
+        ChronosApp app{settings};
+        CHECK(drewWith(app.runFrames(8), path));
+        auto &target = app.getRenderer().getOffscreenTarget();
+        CHECK(target.getImageFormat() == VK_FORMAT_B8G8R8A8_SRGB);
+        std::vector<uint8_t> image = target.readLastFrame();
+        CHECK(image.size() == SIZE * SIZE * 4);
+        if (image.size() != SIZE * SIZE * 4) continue;
+
+        size_t mismatches = 0;
+        for (uint32_t y = 0; y < SIZE; y++) {
+            for (uint32_t x = 0; x < SIZE; x++) {
+                bool inside = x >= SIZE / 4 && x < SIZE * 3 / 4 && y >= SIZE / 4 && y < SIZE * 3 / 4;
+                glm::vec3 expected = inside ? color : clearColor;
+                const uint8_t *texel = &image[(y * SIZE + x) * 4];
+                // B, G, R, A
+                int channels[4] = {srgbByte(expected.z), srgbByte(expected.y), srgbByte(expected.x), 255};
+                for (int c = 0; c < 4; c++) {
+                    if (std::abs(texel[c] - channels[c]) > 2) {
+                        mismatches++;
+                        break;
+                    }
+                }
+            }
+        }
+        CHECK(mismatches == 0);
+    }
+}
+
+struct Check {
+    const char *name;
+    bool needsGpu;
+    std::function<void(const Options &)> run;
+};
+
+Options parseOptions(int argc, char **argv)
+{
+    Options options{};
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            throw std::runtime_error("missing value for " + arg + "!");
+        }
+        std::string value = argv[++i];
+        if (arg == "--shaders") {
+            options.shaderDirectory = value;
+        } else {
+            throw std::runtime_error("unknown option " + arg + "!");
+        }
+    }
+    return options;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    try {
+        Options options = parseOptions(argc, argv);
+        std::vector<Check> checks{
+            {"transform_kernels", false, checkTransformKernels},
+            {"transform_hierarchy", false, checkHierarchy},
+            {"job_system", false, checkJobSystem},
+            {"pipeline_registry", true, checkPipelineRegistry},
+            {"gpu_culling", true, checkGpuCulling},
+            {"golden_image", true, checkGoldenImage},
+        };
+
+        bool gpu = hasVulkanDevice();
+        for (const auto &entry : checks) {
+            if (entry.needsGpu && !gpu) {
+                std::cerr << "selfcheck: " << entry.name << " skipped" << std::endl;
+                continue;
+            }
+            uint32_t failuresBefore = failures;
+            entry.run(options);
+            std::cerr << "selfcheck: " << entry.name << (failures == failuresBefore ? " ok" : " FAILED") << std::endl;
+        }
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -2,3 +2,6 @@
 
 ${VULKAN_SDK}/bin/glslc src/shaders/simple_shader.vert -o src/shaders/simple_shader.vert.spv
 ${VULKAN_SDK}/bin/glslc src/shaders/simple_shader.frag -o src/shaders/simple_shader.frag.spv
+${VULKAN_SDK}/bin/glslc src/shaders/simple_instanced.vert -o src/shaders/simple_instanced.vert.spv
+${VULKAN_SDK}/bin/glslc src/shaders/simple_instanced.frag -o src/shaders/simple_instanced.frag.spv
+${VULKAN_SDK}/bin/glslc src/shaders/cull.comp -o src/shaders/cull.comp.spv
@@ -0,0 +1,385 @@
+#include "chronos_allocator.hpp"
+
+//std
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <map>
+#include <stdexcept>
+
+namespace Chronos {
+
+    namespace {
+        enum class RegionKind : uint8_t { Free, Linear, Optimal };
+
+        struct Region {
+            VkDeviceSize size;
+            RegionKind kind;
+        };
+
+        VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+        {
+            return (value + alignment - 1) & ~(alignment - 1);
+        }
+
+        // True if the last byte of [aOffset, aOffset + aSize) and bOffset fall on the
+        // same bufferImageGranularity page. `a` must lie before `b`.
+        bool onSamePage(VkDeviceSize aOffset, VkDeviceSize aSize, VkDeviceSize bOffset, VkDeviceSize pageSize)
+        {
+            VkDeviceSize aEndPage = (aOffset + aSize - 1) & ~(pageSize - 1);
+            VkDeviceSize bStartPage = bOffset & ~(pageSize - 1);
+            return aEndPage >= bStartPage;
+        }
+
+        bool kindsConflict(RegionKind a, RegionKind b)
+        {
+            return a != RegionKind::Free && b != RegionKind::Free && a != b;
+        }
+    }
+
+    // One vkAllocateMemory carved into regions. Free regions are always coalesced,
+    // so the neighbours of a free region are either used or absent.
+    class ChronosMemoryBlock {
+    public:
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize size = 0;
+        void *mapped = nullptr;
+        uint32_t memoryTypeIndex = 0;
+        uint32_t allocationCount = 0;
+        VkDeviceSize usedBytes = 0;
+
+        std::map<VkDeviceSize, Region> regions;                 // offset -> region
+        std::multimap<VkDeviceSize, VkDeviceSize> freeBySize;   // size -> offset
+
+        void init(VkDeviceSize blockSize)
+        {
+            size = blockSize;
+            regions[0] = {blockSize, RegionKind::Free};
+            freeBySize.emplace(blockSize, 0);
+        }
+
+        bool tryAllocate(
+                VkDeviceSize allocSize,
+                VkDeviceSize alignment,
+                RegionKind kind,
+                VkDeviceSize granularity,
+                VkDeviceSize &outOffset)
+        {
+            // best fit: smallest free region that can hold the request after alignment
+            for (auto candidate = freeBySize.lower_bound(allocSize); candidate != freeBySize.end(); ++candidate) {
+                auto regionIt = regions.find(candidate->second);
+                assert(regionIt != regions.end() && regionIt->second.kind == RegionKind::Free);
+
+                VkDeviceSize regionOffset = regionIt->first;
+                VkDeviceSize regionEnd = regionOffset + regionIt->second.size;
+                VkDeviceSize offset = alignUp(regionOffset, alignment);
+
+                if (granularity > 1 && regionIt != regions.begin()) {
+                    auto prev = std::prev(regionIt);
+                    if (kindsConflict(prev->second.kind, kind) &&
+                            onSamePage(prev->first, prev->second.size, offset, granularity)) {
+                        offset = alignUp(offset, granularity);
+                    }
+                }
+
+                if (offset + allocSize > regionEnd) {
+                    continue;
+                }
+
+                if (granularity > 1) {
+                    auto next = std::next(regionIt);
+                    if (next != regions.end() && kindsConflict(kind, next->second.kind) &&
+                            onSamePage(offset, allocSize, next->first, granularity)) {
+                        continue;
+                    }
+                }
+
+                freeBySize.erase(candidate);
+                regions.erase(regionIt);
+
+                if (offset > regionOffset) {
+                    insertFree(regionOffset, offset - regionOffset);
+                }
+                regions[offset] = {allocSize, kind};
+                if (offset + allocSize < regionEnd) {
+                    insertFree(offset + allocSize, regionEnd - (offset + allocSize));
+                }
+
+                allocationCount++;
+                usedBytes += allocSize;
+                outOffset = offset;
+                return true;
+            }
+            return false;
+        }
+
+        void release(VkDeviceSize offset)
+        {
+            auto regionIt = regions.find(offset);
+            assert(regionIt != regions.end() && regionIt->second.kind != RegionKind::Free &&
+                    "Freeing an allocation that does not belong to this block");
+
+            VkDeviceSize freeOffset = regionIt->first;
+            VkDeviceSize freeSize = regionIt->second.size;
+            usedBytes -= freeSize;
+            allocationCount--;
+
+            auto next = std::next(regionIt);
+            if (next != regions.end() && next->second.kind == RegionKind::Free) {
+                eraseFreeBySize(next->first, next->second.size);
+                freeSize += next->second.size;
+                regions.erase(next);
+            }
+            if (regionIt != regions.begin()) {
+                auto prev = std::prev(regionIt);
+                if (prev->second.kind == RegionKind::Free) {
+                    eraseFreeBySize(prev->first, prev->second.size);
+                    freeOffset = prev->first;
+                    freeSize += prev->second.size;
+                    regions.erase(prev);
+                }
+            }
+            regions.erase(offset);
+            insertFree(freeOffset, freeSize);
+        }
+
+        VkDeviceSize largestFreeRange() const
+        {
+            return freeBySize.empty() ? 0 : freeBySize.rbegin()->first;
+        }
+
+    private:
+        void insertFree(VkDeviceSize offset, VkDeviceSize regionSize)
+        {
+            regions[offset] = {regionSize, RegionKind::Free};
+            freeBySize.emplace(regionSize, offset);
+        }
+
+        void eraseFreeBySize(VkDeviceSize offset, VkDeviceSize regionSize)
+        {
+            auto range = freeBySize.equal_range(regionSize);
+            for (auto it = range.first; it != range.second; ++it) {
+                if (it->second == offset) {
+                    freeBySize.erase(it);
+                    return;
+                }
+            }
+            assert(false && "Free region missing from size index");
+        }
+    };
+
+    ChronosAllocator::ChronosAllocator(VkDevice device, VkPhysicalDevice physicalDevice) : device{device}
+    {
+        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+        bufferImageGranularity = properties.limits.bufferImageGranularity;
+        maxMemoryAllocationCount = properties.limits.maxMemoryAllocationCount;
+
+        blocksByType.resize(memoryProperties.memoryTypeCount);
+    }
+
+    ChronosAllocator::~ChronosAllocator()
+    {
+        for (auto &blocks : blocksByType) {
+            for (auto &block : blocks) {
+                assert(block->allocationCount == 0 && "Allocator destroyed with live allocations");
+                vkFreeMemory(device, block->memory, nullptr);
+            }
+        }
+        assert(dedicatedAllocationCount == 0 && "Allocator destroyed with live dedicated allocations");
+    }
+
+    ChronosAllocation ChronosAllocator::allocate(
+            const VkMemoryRequirements &requirements,
+            uint32_t memoryTypeIndex,
+            bool linear)
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        VkDeviceSize blockSize = preferredBlockSize(memoryTypeIndex);
+        if (requirements.size > blockSize / 2) {
+            return allocateDedicated(requirements.size, memoryTypeIndex);
+        }
+
+        RegionKind kind = linear ? RegionKind::Linear : RegionKind::Optimal;
+        VkDeviceSize alignment = std::max<VkDeviceSize>(requirements.alignment, 1);
+
+        ChronosAllocation allocation{};
+        allocation.size = requirements.size;
+        allocation.memoryTypeIndex = memoryTypeIndex;
+
+        VkDeviceSize offset = 0;
+        ChronosMemoryBlock *target = nullptr;
+        for (auto &block : blocksByType[memoryTypeIndex]) {
+            if (block->size - block->usedBytes < requirements.size) {
+                continue;
+            }
+            if (block->tryAllocate(requirements.size, alignment, kind, bufferImageGranularity, offset)) {
+                target = block.get();
+                break;
+            }
+        }
+
+        if (target == nullptr) {
+            target = createBlock(memoryTypeIndex, requirements.size);
+            if (!target->tryAllocate(requirements.size, alignment, kind, bufferImageGranularity, offset)) {
+                throw std::runtime_error("failed to sub-allocate from a fresh memory block!");
+            }
+        }
+
+        allocation.memory = target->memory;
+        allocation.offset = offset;
+        allocation.block = target;
+        if (target->mapped != nullptr) {
+            allocation.mappedData = static_cast<char *>(target->mapped) + offset;
+        }
+        return allocation;
+    }
+
+    void ChronosAllocator::free(ChronosAllocation &allocation)
+    {
+        if (allocation.memory == VK_NULL_HANDLE) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock{mutex};
+
+        if (allocation.block == nullptr) {
+            vkFreeMemory(device, allocation.memory, nullptr);
+            deviceAllocationCount--;
+            dedicatedAllocationCount--;
+            dedicatedBytes -= allocation.size;
+            allocation = {};
+            return;
+        }
+
+        ChronosMemoryBlock *block = allocation.block;
+        block->release(allocation.offset);
+        allocation = {};
+
+        if (block->allocationCount == 0) {
+            // keep one empty block per memory type around so a load/unload cycle
+            // does not bounce every allocation through the driver
+            auto &blocks = blocksByType[block->memoryTypeIndex];
+            bool hasOtherEmptyBlock = std::any_of(blocks.begin(), blocks.end(), [block](const auto &other) {
+                return other.get() != block && other->allocationCount == 0;
+            });
+            if (hasOtherEmptyBlock) {
+                destroyBlock(block);
+            }
+        }
+    }
+
+    ChronosAllocatorStats ChronosAllocator::getStats()
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        ChronosAllocatorStats stats{};
+        stats.dedicatedAllocationCount = dedicatedAllocationCount;
+        stats.allocationCount = dedicatedAllocationCount;
+        stats.reservedBytes = dedicatedBytes;
+        stats.usedBytes = dedicatedBytes;
+
+        for (auto &blocks : blocksByType) {
+            for (auto &block : blocks) {
+                VkDeviceSize freeBytes = block->size - block->usedBytes;
+                stats.blockCount++;
+                stats.allocationCount += block->allocationCount;
+                stats.reservedBytes += block->size;
+                stats.usedBytes += block->usedBytes;
+                stats.freeBytes += freeBytes;
+                stats.fragmentedBytes += freeBytes - block->largestFreeRange();
+            }
+        }
+        return stats;
+    }
+
+    ChronosMemoryBlock *ChronosAllocator::createBlock(uint32_t memoryTypeIndex, VkDeviceSize minSize)
+    {
+        VkDeviceSize blockSize = preferredBlockSize(memoryTypeIndex);
+
+        auto block = std::make_unique<ChronosMemoryBlock>();
+        block->memoryTypeIndex = memoryTypeIndex;
+
+        // fall back to smaller blocks when the heap is close to full
+        while (true) {
+            try {
+                block->memory = allocateDeviceMemory(blockSize, memoryTypeIndex, &block->mapped);
+                break;
+            } catch (const std::runtime_error &) {
+                if (blockSize / 2 < minSize) {
+                    throw;
+                }
+                blockSize /= 2;
+            }
+        }
+        block->init(blockSize);
+
+        blocksByType[memoryTypeIndex].push_back(std::move(block));
+        return blocksByType[memoryTypeIndex].back().get();
+    }
+
+    void ChronosAllocator::destroyBlock(ChronosMemoryBlock *block)
+    {
+        auto &blocks = blocksByType[block->memoryTypeIndex];
+        auto it = std::find_if(blocks.begin(), blocks.end(), [block](const auto &other) {
+            return other.get() == block;
+        });
+        assert(it != blocks.end() && "Block does not belong to this allocator");
+
+        vkFreeMemory(device, block->memory, nullptr);
+        deviceAllocationCount--;
+        blocks.erase(it);
+    }
+
+    ChronosAllocation ChronosAllocator::allocateDedicated(VkDeviceSize size, uint32_t memoryTypeIndex)
+    {
+        ChronosAllocation allocation{};
+        allocation.memory = allocateDeviceMemory(size, memoryTypeIndex, &allocation.mappedData);
+        allocation.offset = 0;
+        allocation.size = size;
+        allocation.memoryTypeIndex = memoryTypeIndex;
+        allocation.block = nullptr;
+
+        dedicatedAllocationCount++;
+        dedicatedBytes += size;
+        return allocation;
+    }
+
+    VkDeviceMemory ChronosAllocator::allocateDeviceMemory(VkDeviceSize size, uint32_t memoryTypeIndex, void **mapped)
+    {
+        if (deviceAllocationCount >= maxMemoryAllocationCount) {
+            throw std::runtime_error("exceeded maxMemoryAllocationCount!");
+        }
+
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = size;
+        allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+        VkDeviceMemory memory;
+        if (vkAllocateMemory(device, &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate device memory!");
+        }
+        deviceAllocationCount++;
+
+        *mapped = nullptr;
+        if (memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+            if (vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, mapped) != VK_SUCCESS) {
+                vkFreeMemory(device, memory, nullptr);
+                deviceAllocationCount--;
+                throw std::runtime_error("failed to map device memory!");
+            }
+        }
+        return memory;
+    }
+
+    VkDeviceSize ChronosAllocator::preferredBlockSize(uint32_t memoryTypeIndex) const
+    {
+        uint32_t heapIndex = memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+        VkDeviceSize heapSize = memoryProperties.memoryHeaps[heapIndex].size;
+        return heapSize <= SMALL_HEAP_MAX_SIZE ? heapSize / 8 : DEFAULT_BLOCK_SIZE;
+    }
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+//std
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Chronos {
+
+    class ChronosMemoryBlock;
+
+    // A sub-range of a VkDeviceMemory block handed out by ChronosAllocator.
+    // Resources must be bound at `offset`, never at 0.
+    struct ChronosAllocation {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+        VkDeviceSize size = 0;
+        void *mappedData = nullptr; // persistently mapped for HOST_VISIBLE types
+        uint32_t memoryTypeIndex = 0;
+        ChronosMemoryBlock *block = nullptr; // nullptr for dedicated allocations
+    };
+
+    struct ChronosAllocatorStats {
+        uint32_t blockCount = 0;
+        uint32_t dedicatedAllocationCount = 0;
+        uint32_t allocationCount = 0;
+        VkDeviceSize reservedBytes = 0;
+        VkDeviceSize usedBytes = 0;
+        VkDeviceSize freeBytes = 0;
+        // free bytes that are not part of the largest free range of their block
+        VkDeviceSize fragmentedBytes = 0;
+    };
+
+    class ChronosAllocator {
+    public:
+        static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 256ull * 1024 * 1024;
+        static constexpr VkDeviceSize SMALL_HEAP_MAX_SIZE = 1024ull * 1024 * 1024;
+
+        ChronosAllocator(VkDevice device, VkPhysicalDevice physicalDevice);
+        ~ChronosAllocator();
+
+        ChronosAllocator(const ChronosAllocator &) = delete;
+        ChronosAllocator &operator=(const ChronosAllocator &) = delete;
+
+        // `linear` is true for buffers and linear-tiled images; it is used to keep
+        // linear and optimal resources bufferImageGranularity apart inside a block.
+        ChronosAllocation allocate(
+                const VkMemoryRequirements &requirements,
+                uint32_t memoryTypeIndex,
+                bool linear);
+        void free(ChronosAllocation &allocation);
+
+        ChronosAllocatorStats getStats();
+
+    private:
+        ChronosMemoryBlock *createBlock(uint32_t memoryTypeIndex, VkDeviceSize minSize);
+        void destroyBlock(ChronosMemoryBlock *block);
+        ChronosAllocation allocateDedicated(VkDeviceSize size, uint32_t memoryTypeIndex);
+        VkDeviceMemory allocateDeviceMemory(VkDeviceSize size, uint32_t memoryTypeIndex, void **mapped);
+        VkDeviceSize preferredBlockSize(uint32_t memoryTypeIndex) const;
+
+    private:
+        VkDevice device;
+        VkPhysicalDeviceMemoryProperties memoryProperties;
+        VkDeviceSize bufferImageGranularity;
+        uint32_t maxMemoryAllocationCount;
+        uint32_t deviceAllocationCount = 0;
+
+        std::vector<std::vector<std::unique_ptr<ChronosMemoryBlock>>> blocksByType;
+        uint32_t dedicatedAllocationCount = 0;
+        VkDeviceSize dedicatedBytes = 0;
+
+        std::mutex mutex;
+    };
+}
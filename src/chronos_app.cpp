@@ -1,4 +1,5 @@
 #include "chronos_app.hpp"
+#include "chronos_transform_batch.hpp"
 
 //libs
 #define GLM_FORCE_RADIANS
@@ -7,7 +8,12 @@
 #include <glm/gtc/constants.hpp>
 
 //std
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
 #include <stdexcept>
 #include <vector>
 
@@ -22,8 +28,36 @@ namespace Chronos {
     };
 
 
-    ChronosApp::ChronosApp()
+    ChronosApp::ChronosApp() : ChronosApp(Settings{}) {}
+
+    ChronosApp::ChronosApp(const Settings &settings) : settings{settings}, jobSystem{settings.jobWorkers}
     {
+        if (settings.headless) {
+            chronosDevice = std::make_unique<ChronosDevice>(settings.pipelineCacheDirectory);
+            chronosRenderer = std::make_unique<ChronosRenderer>(
+                    *chronosDevice, settings.extent, settings.presentConfig, jobSystem.getThreadCount());
+        } else {
+            chronosWindow = std::make_unique<ChronosWindow>(
+                    static_cast<int>(settings.extent.width), static_cast<int>(settings.extent.height), "HELLO VULKAN!");
+            chronosDevice = std::make_unique<ChronosDevice>(*chronosWindow, settings.pipelineCacheDirectory);
+            chronosRenderer = std::make_unique<ChronosRenderer>(
+                    *chronosWindow, *chronosDevice, settings.presentConfig, jobSystem.getThreadCount());
+        }
+        shaderLibrary = std::make_unique<ChronosShaderLibrary>(*chronosDevice);
+        layoutCache = std::make_unique<ChronosPipelineLayoutCache>(*chronosDevice);
+        pipelineRegistry = std::make_unique<ChronosPipelineRegistry>(*chronosDevice, *shaderLibrary);
+        if (settings.hotReloadShaders) {
+            shaderWatcher = std::make_unique<ChronosShaderWatcher>(settings.shaderDirectory);
+        }
+
+        if (settings.printStats) {
+            std::cout << "Transform kernel: " << simdLevelName(detectSimdLevel()) << ", "
+                      << jobSystem.getThreadCount() << " job threads" << std::endl;
+        }
+        transformHierarchy.setParallelFor(
+                [this](size_t begin, size_t end, size_t grainSize, const ChronosJobSystem::RangeFunction &body) {
+                    jobSystem.parallelFor(begin, end, grainSize, body);
+                });
         loadGameObjects();
         createPipelineLayout();
         createPipeline();
@@ -31,88 +65,576 @@ namespace Chronos {
 
     ChronosApp::~ChronosApp()
     {
-        vkDestroyPipelineLayout(chronosDevice.device(), pipelineLayout, nullptr);
+        // joins the compile threads, which may still be using the layout
+        pipelineRegistry.reset();
     }
 
     void ChronosApp::run() {
-        while (!chronosWindow.shouldClose()) {
+        assert(chronosWindow && "run() needs a window; use runFrames() when headless");
+        startSimulation();
+
+        // some platforms block in glfwPollEvents for as long as the user drags the
+        // window border, so frames are drawn from the refresh callback meanwhile
+        chronosWindow->setRefreshCallback([this]() {
+            // also fires while a minimized window holds up swap chain recreation mid-frame
+            if (drawingFrame) return;
+            chronosRenderer->waitForNextFrame();
+            drawFrame();
+        });
+        while (!chronosWindow->shouldClose()) {
+            // input and the snapshot are picked only once the frame can start
+            chronosRenderer->waitForNextFrame();
             glfwPollEvents();
-            
-            if (auto commandBuffer = chronosRenderer.beginFrame()) {
-                chronosRenderer.beginSwapChainRenderPass(commandBuffer);
-                renderGameObjects(commandBuffer);
-                chronosRenderer.endSwapChainRenderPass(commandBuffer);
-                chronosRenderer.endFrame();
+            drawFrame();
+        }
+        chronosWindow->setRefreshCallback(nullptr);
+
+        stopSimulation();
+    }
+
+    std::vector<ChronosApp::FrameSample> ChronosApp::runFrames(uint32_t frameCount)
+    {
+        std::vector<FrameSample> samples;
+        samples.reserve(frameCount);
+
+        if (settings.waitForPipelines) {
+            waitForPipelines();
+        }
+        startSimulation();
+        while (samples.size() < frameCount && !(chronosWindow && chronosWindow->shouldClose())) {
+            chronosRenderer->waitForNextFrame();
+            if (chronosWindow) {
+                glfwPollEvents();
+            }
+            if (drawFrame()) {
+                samples.push_back(lastFrameSample);
+            }
+        }
+        stopSimulation();
+        return samples;
+    }
+
+    void ChronosApp::startSimulation()
+    {
+        if (settings.threadingMode == ThreadingMode::Pipelined) {
+            simulationRunning = true;
+            simulationThread = std::thread{&ChronosApp::simulationLoop, this};
+        }
+        statsStart = std::chrono::steady_clock::now();
+        previousFrame = statsStart;
+        previousStep = statsStart;
+    }
+
+    void ChronosApp::stopSimulation()
+    {
+        snapshotQueue.close();
+        if (simulationThread.joinable()) {
+            simulationRunning = false;
+            simulationThread.join();
+        }
+        vkDeviceWaitIdle(chronosDevice->device());
+    }
+
+    bool ChronosApp::drawFrame()
+    {
+        using clock = std::chrono::steady_clock;
+        drawingFrame = true;
+
+        if (settings.threadingMode == ThreadingMode::SingleThreaded && (!currentSnapshot || snapshotRecorded)) {
+            auto now = clock::now();
+            stepAccumulator += now - previousStep;
+            previousStep = now;
+            if (stepAccumulator > MAX_FRAME_TIME) {
+                stepAccumulator = MAX_FRAME_TIME;
+                droppedStalls++;
+            }
+            bool stepped = false;
+            while (stepAccumulator >= FIXED_TIMESTEP) {
+                runSimulationStep();
+                stepAccumulator -= FIXED_TIMESTEP;
+                stepped = true;
+            }
+            if (stepped || !currentSnapshot) {
+                publishSnapshot(now, now - stepAccumulator);
+            }
+        }
+
+        if (!currentSnapshot || snapshotRecorded) {
+            if (auto next = snapshotQueue.next(currentSnapshot ? std::chrono::milliseconds{0} : SNAPSHOT_WAIT)) {
+                currentSnapshot = next;
+                snapshotRecorded = false;
+            }
+        }
+        if (simulationFailed) {
+            drawingFrame = false;
+            stopSimulation();
+            std::rethrow_exception(simulationError);
+        }
+        if (!currentSnapshot) {
+            drawingFrame = false;
+            return false;
+        }
+
+        reloadChangedShaders();
+        adoptReadyPipeline(chronosPipeline, pendingPipeline);
+        adoptReadyPipeline(instancedPipeline, pendingInstancedPipeline);
+        // the per-object pipeline is built up front, so it stands in while the
+        // instanced one compiles
+        RenderPath renderPath = instancedPipeline ? settings.renderPath : RenderPath::PerObject;
+
+        bool drawn = false;
+        if (auto commandBuffer = chronosRenderer->beginFrame()) {
+            uint32_t workerCount =
+                    renderPath == RenderPath::PerObject ? recordingWorkerCount(currentSnapshot->objects.size()) : 1;
+            auto recordStart = clock::now();
+            float alpha = currentSnapshot->interpolationAlpha(recordStart, FIXED_TIMESTEP);
+
+            // compute work has to be recorded before the render pass begins; culling keeps
+            // its uploads current even while the fallback draws
+            if (settings.renderPath == RenderPath::GpuDriven) {
+                gpuCulling->record(commandBuffer, chronosRenderer->getFrameIndex(), *currentSnapshot, alpha);
+            }
+
+            chronosRenderer->beginSwapChainRenderPass(
+                    commandBuffer,
+                    workerCount > 1 ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
+
+            uint32_t drawCalls = 0;
+            switch (renderPath) {
+                case RenderPath::PerObject:
+                    drawCalls = renderGameObjects(commandBuffer, *currentSnapshot, alpha, workerCount);
+                    break;
+                case RenderPath::Instanced:
+                    drawCalls = renderGameObjectsInstanced(commandBuffer, *currentSnapshot, alpha);
+                    break;
+                case RenderPath::GpuDriven:
+                    instancedPipeline->bind(commandBuffer);
+                    drawCalls = gpuCulling->draw(commandBuffer, chronosRenderer->getFrameIndex());
+                    break;
+            }
+            std::chrono::duration<double, std::milli> recordTime = clock::now() - recordStart;
+
+            chronosRenderer->endSwapChainRenderPass(commandBuffer);
+            chronosRenderer->endFrame();
+
+            auto presented = clock::now();
+            double snapshotLatency = -1.0;
+            if (!snapshotRecorded) {
+                std::chrono::duration<double, std::milli> latency = presented - currentSnapshot->simulationStart;
+                snapshotLatency = latency.count();
+                latencyMilliseconds += latency.count();
+                latencySamples++;
+                snapshotRecorded = true;
+            }
+            std::chrono::duration<double, std::milli> frameTime = presented - previousFrame;
+            previousFrame = presented;
+            if (recordedFrames == 0 || frameTime.count() < minFrameMilliseconds) {
+                minFrameMilliseconds = frameTime.count();
+            }
+            maxFrameMilliseconds = std::max(maxFrameMilliseconds, frameTime.count());
+            lastFrameSample = {
+                    frameTime.count(), recordTime.count(), chronosRenderer->getGpuMilliseconds(), drawCalls,
+                    snapshotLatency, renderPath};
+            drawn = true;
+
+            recordingMilliseconds += recordTime.count();
+            recordedDrawCalls += drawCalls;
+            if (++recordedFrames == STATS_INTERVAL) {
+                std::chrono::duration<double> elapsed = presented - statsStart;
+                uint64_t steps = simulationSteps.exchange(0);
+                uint64_t stepNanoseconds = simulationNanoseconds.exchange(0);
+                uint64_t stalls = droppedStalls.exchange(0);
+                auto latency = chronosRenderer->takeLatencyStats();
+                if (settings.printStats) {
+                    std::cout << (settings.threadingMode == ThreadingMode::Pipelined ? "Pipelined" : "Single-threaded")
+                              << ": " << recordedFrames / elapsed.count() << " fps, frame "
+                              << minFrameMilliseconds << "/" << elapsed.count() * 1000.0 / recordedFrames << "/"
+                              << maxFrameMilliseconds << " ms min/avg/max, "
+                              << (latencySamples ? latencyMilliseconds / latencySamples : 0.0)
+                              << " ms simulation-to-present latency" << std::endl;
+                    std::cout << "Present: " << ChronosSwapChain::presentModeName(chronosRenderer->getPresentMode())
+                              << ", " << chronosRenderer->getFramesInFlight() << " frames in flight"
+                              << (chronosRenderer->isLowLatency() ? ", low latency" : "") << ", "
+                              << (latency.samples ? latency.totalMilliseconds / latency.samples : 0.0) << "/"
+                              << latency.maxMilliseconds << " ms avg/max input-to-GPU-done latency" << std::endl;
+                    std::cout << "Simulation: " << steps / elapsed.count() << " steps/s, "
+                              << (steps ? stepNanoseconds / 1e6 / steps : 0.0) << " ms/step, "
+                              << stalls << " stalls clamped" << std::endl;
+                    std::cout << "Recording: " << recordingMilliseconds / recordedFrames << " ms/frame, "
+                              << recordedDrawCalls / recordedFrames << " draws/frame, "
+                              << currentSnapshot->objects.size() << " objects, " << workerCount << " threads"
+                              << std::endl;
+                    if (settings.renderPath == RenderPath::GpuDriven) {
+                        const auto &cullStats = gpuCulling->getStats();
+                        std::cout << "GPU culling: " << cullStats.visibleCount << " visible, "
+                                  << cullStats.culledCount << " culled of " << cullStats.objectCount << std::endl;
+                    }
+                }
+                if (settings.cyclePresentModes) {
+                    cyclePresentMode();
+                }
+                recordingMilliseconds = 0.0;
+                latencyMilliseconds = 0.0;
+                latencySamples = 0;
+                maxFrameMilliseconds = 0.0;
+                recordedDrawCalls = 0;
+                recordedFrames = 0;
+                statsStart = presented;
+            }
+        }
+        drawingFrame = false;
+        return drawn;
+    }
+
+    void ChronosApp::update(float dt)
+    {
+        // no gameplay systems yet; scenes move objects through updateScene
+        if (settings.updateScene) {
+            settings.updateScene(registry, dt);
+        }
+    }
+
+    void ChronosApp::runSimulationStep()
+    {
+        auto start = std::chrono::steady_clock::now();
+        update(std::chrono::duration<float>(FIXED_TIMESTEP).count());
+        std::chrono::nanoseconds stepTime = std::chrono::steady_clock::now() - start;
+        simulationNanoseconds += stepTime.count();
+        simulationSteps++;
+    }
+
+    bool ChronosApp::publishSnapshot(
+            std::chrono::steady_clock::time_point simulationStart,
+            std::chrono::steady_clock::time_point tickTime)
+    {
+        transformHierarchy.update(registry);
+        bool published = snapshotQueue.publish(registry, transformHierarchy, simulationStart, tickTime);
+        // the snapshot has consumed these changes
+        registry.clearDirty();
+        return published;
+    }
+
+    void ChronosApp::simulationLoop()
+    {
+        using clock = std::chrono::steady_clock;
+
+        clock::time_point nextStep = clock::now();
+        try {
+            while (simulationRunning) {
+                auto now = clock::now();
+                if (now < nextStep) {
+                    std::this_thread::sleep_until(nextStep);
+                    continue;
+                }
+                if (now - nextStep > MAX_FRAME_TIME) {
+                    nextStep = now;
+                    droppedStalls++;
+                }
+
+                clock::time_point tickTime = nextStep;
+                runSimulationStep();
+                nextStep += FIXED_TIMESTEP;
+
+                // catch up on missed steps before publishing; publish() blocks while the
+                // renderer is a full queue behind
+                if (clock::now() < nextStep && !publishSnapshot(now, tickTime)) {
+                    return;
+                }
             }
+        } catch (...) {
+            // handed to the render thread, which stops waiting for snapshots once the queue closes
+            simulationError = std::current_exception();
+            simulationFailed = true;
+            snapshotQueue.close();
         }
-        vkDeviceWaitIdle(chronosDevice.device());
     }
 
     void ChronosApp::loadGameObjects()
     {
-        std::vector<ChronosModel::Vertex> vertices 
-        {
+        if (settings.buildScene) {
+            settings.buildScene(*chronosDevice, registry, jobSystem);
+            return;
+        }
+
+        ChronosModel::Builder modelBuilder{};
+        modelBuilder.loadVertices({
             {{ 0.0f,-0.5f}, {1.0f, 0.0f, 0.0f}},
             {{ 0.5f, 0.5f}, {0.0f, 1.0f, 0.0f}},
             {{-0.5f, 0.5f}, {0.0f, 0.0f, 1.0f}},
-        };
+        });
 
-        auto chronosModel = std::make_shared<ChronosModel>(chronosDevice, vertices);
+        auto chronosModel = std::make_shared<ChronosModel>(*chronosDevice, modelBuilder);
 
-        auto triangle = ChronosGameObject::createGameObject();
-        triangle.model = chronosModel;
-        triangle.color = {.1f, .8f, .1f};
-        triangle.transform2d.translation.x = .2f;
-        triangle.transform2d.scale = {2.f, .5f};
-        triangle.transform2d.rotation = .25f * glm::two_pi<float>();
+        auto triangle = registry.create();
+        registry.add<ModelComponent>(triangle, {chronosModel});
+        registry.add<ColorComponent>(triangle, {{.1f, .8f, .1f}});
+        auto &transform = registry.add<Transform2dComponent>(triangle);
+        transform.translation.x = .2f;
+        transform.scale = {2.f, .5f};
+        transform.rotation = .25f * glm::two_pi<float>();
 
-        gameObjects.push_back(std::move(triangle));
+        // a quarter turn per second, stepped at the fixed rate and interpolated when drawn
+        if (!settings.updateScene) {
+            settings.updateScene = [triangle](ChronosRegistry &registry, float dt) {
+                registry.patch<Transform2dComponent>(triangle, [dt](Transform2dComponent &t) {
+                    t.rotation = std::fmod(t.rotation + .25f * glm::two_pi<float>() * dt, glm::two_pi<float>());
+                });
+            };
+        }
     }
 
     void ChronosApp::createPipelineLayout()
     {
-        VkPushConstantRange pushConstantRange{};
-        pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT || VK_SHADER_STAGE_FRAGMENT_BIT;
-        pushConstantRange.offset = 0;
-        pushConstantRange.size = sizeof(SimplePushConstantData);
+        // derived from the per-object shaders; the instanced ones use a subset of it
+        auto vertShader = shaderLibrary->loadModule(settings.shaderDirectory + "simple_shader.vert.spv");
+        auto fragShader = shaderLibrary->loadModule(settings.shaderDirectory + "simple_shader.frag.spv");
+        pipelineLayout = layoutCache->getLayout({&vertShader->getReflection(), &fragShader->getReflection()});
+
+        for (const auto *reflection : {&vertShader->getReflection(), &fragShader->getReflection()}) {
+            if (reflection->pushConstantSize < sizeof(SimplePushConstantData)) {
+                throw std::runtime_error("simple_shader push constants are smaller than SimplePushConstantData!");
+            }
+        }
+    }
+
+    void ChronosApp::configurePipeline(PipelineConfigInfo &configInfo, bool instanced)
+    {
+        ChronosPipeline::defaultPipelineConfigInfo(configInfo);
+        configInfo.renderPass = chronosRenderer->getSwapChainRenderPass();
+        configInfo.pipelineLayout = pipelineLayout;
+        if (instanced) {
+            auto instanceBindings = ChronosInstanceBuffer::InstanceData::getBindingDescriptions();
+            auto instanceAttributes = ChronosInstanceBuffer::InstanceData::getAttributeDescriptions();
+            configInfo.bindingDescriptions.insert(
+                    configInfo.bindingDescriptions.end(), instanceBindings.begin(), instanceBindings.end());
+            configInfo.attributeDescriptions.insert(
+                    configInfo.attributeDescriptions.end(), instanceAttributes.begin(), instanceAttributes.end());
+        }
+    }
+
+    void ChronosApp::requestInstancedPipeline()
+    {
+        PipelineConfigInfo instancedConfig{};
+        configurePipeline(instancedConfig, true);
+        pendingInstancedPipeline = pipelineRegistry->requestPipeline(
+                settings.shaderDirectory + "simple_instanced.vert.spv",
+                settings.shaderDirectory + "simple_instanced.frag.spv",
+                instancedConfig);
+    }
+
+    void ChronosApp::adoptReadyPipeline(
+            std::shared_ptr<ChronosPipeline> &pipeline,
+            ChronosPipelineRegistry::PipelineFuture &pending)
+    {
+        if (!ChronosPipelineRegistry::isReady(pending)) {
+            return;
+        }
+        try {
+            auto ready = pending.get();
+            if (pipeline && pipeline != ready) {
+                chronosRenderer->retire(std::move(pipeline));
+            }
+            pipeline = std::move(ready);
+        } catch (const std::exception &e) {
+            // A broken shader edit keeps the last good pipeline drawing. Without one the
+            // pipeline stays null and frames draw per object. The failed request is not
+            // repeated; the next edit of its shaders requests it again.
+            std::cerr << e.what() << std::endl;
+            if (!pipeline) {
+                std::cerr << "pipeline unavailable, drawing per object until its shaders are fixed" << std::endl;
+            }
+        }
+        pending = {};
+    }
+
+    void ChronosApp::waitForPipelines()
+    {
+        for (auto *pending : {&pendingPipeline, &pendingInstancedPipeline}) {
+            if (pending->valid()) {
+                pending->get();
+            }
+        }
+        adoptReadyPipeline(chronosPipeline, pendingPipeline);
+        adoptReadyPipeline(instancedPipeline, pendingInstancedPipeline);
+    }
+
+    void ChronosApp::reloadChangedShaders()
+    {
+        if (!shaderWatcher) {
+            return;
+        }
+        bool graphicsChanged = false;
+        for (const auto &spirvPath : shaderWatcher->takeCompiledShaders()) {
+            graphicsChanged = pipelineRegistry->invalidateShader(spirvPath) > 0 || graphicsChanged;
+            if (gpuCulling && spirvPath == gpuCulling->getShaderFilepath()) {
+                try {
+                    chronosRenderer->retire(gpuCulling->reloadShader(*shaderLibrary));
+                } catch (const std::exception &e) {
+                    std::cerr << e.what() << std::endl;
+                }
+            }
+        }
+        if (!graphicsChanged) {
+            return;
+        }
 
-        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-        pipelineLayoutInfo.setLayoutCount = 0; // FIX: Should set to one
-        pipelineLayoutInfo.pSetLayouts = nullptr; // FIX: should reference the descriptorSetLayouts
-        pipelineLayoutInfo.pushConstantRangeCount = 1;
-        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
-        if (vkCreatePipelineLayout(chronosDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
-        {
-            throw std::runtime_error("failed to creaet pipeline layout");
+        // Unchanged pipelines hit the registry and come back as they are; the rest
+        // compile in the background while the current ones keep drawing.
+        if (fitsPipelineLayout({"simple_shader.vert.spv", "simple_shader.frag.spv"})) {
+            PipelineConfigInfo pipelineConfig{};
+            configurePipeline(pipelineConfig, false);
+            pendingPipeline = pipelineRegistry->requestPipeline(
+                    settings.shaderDirectory + "simple_shader.vert.spv",
+                    settings.shaderDirectory + "simple_shader.frag.spv",
+                    pipelineConfig);
+        }
+        // the instanced shaders only need a subset, so merged with the per-object
+        // ones they must still come to the same layout
+        if (fitsPipelineLayout({"simple_shader.vert.spv", "simple_shader.frag.spv",
+                                "simple_instanced.vert.spv", "simple_instanced.frag.spv"})) {
+            requestInstancedPipeline();
         }
     }
 
+    bool ChronosApp::fitsPipelineLayout(const std::vector<std::string> &shaderNames)
+    {
+        try {
+            std::vector<std::shared_ptr<ChronosShaderModule>> modules;
+            std::vector<const ChronosShaderReflection *> stages;
+            for (const auto &name : shaderNames) {
+                modules.push_back(shaderLibrary->loadModule(settings.shaderDirectory + name));
+                stages.push_back(&modules.back()->getReflection());
+            }
+            if (layoutCache->getLayout(stages) == pipelineLayout) {
+                return true;
+            }
+            std::cerr << "shader edit changes the pipeline layout, restart to apply it: " << shaderNames.back()
+                      << std::endl;
+        } catch (const std::exception &e) {
+            std::cerr << e.what() << std::endl;
+        }
+        return false;
+    }
+
     void ChronosApp::createPipeline()
     {
         assert(pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout!");
 
-        PipelineConfigInfo pipelineConfig{}; 
-        ChronosPipeline::defaultPipelineConfigInfo(pipelineConfig);
-        pipelineConfig.renderPass = chronosRenderer.getSwapChainRenderPass();
-        pipelineConfig.pipelineLayout = pipelineLayout;
-        chronosPipeline = std::make_unique<ChronosPipeline>(
-                chronosDevice,
-                "/home/cogent/dev/vengine/src/shaders/simple_shader.vert.spv",
-                "/home/cogent/dev/vengine/src/shaders/simple_shader.frag.spv",
+        PipelineConfigInfo pipelineConfig{};
+        configurePipeline(pipelineConfig, false);
+
+        auto start = std::chrono::steady_clock::now();
+        chronosPipeline = pipelineRegistry->getPipeline(
+                settings.shaderDirectory + "simple_shader.vert.spv",
+                settings.shaderDirectory + "simple_shader.frag.spv",
                 pipelineConfig);
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        requestInstancedPipeline();
+        if (settings.printStats) {
+            auto registryStats = pipelineRegistry->getStats();
+            std::cout << "Pipeline creation: " << elapsed.count() << " ms ("
+                      << (chronosDevice->isPipelineCacheWarm() ? "warm" : "cold") << " cache)" << std::endl;
+            std::cout << "Pipeline registry: " << registryStats.misses << " built, " << registryStats.hits
+                      << " shared" << std::endl;
+        }
+        instanceBuffer = std::make_unique<ChronosInstanceBuffer>(*chronosDevice, chronosRenderer->getFramesInFlight());
+
+        // the render path is fixed for the app's lifetime, so only the GPU-driven one pays for culling
+        if (settings.renderPath == RenderPath::GpuDriven) {
+            gpuCulling = std::make_unique<ChronosGpuCulling>(
+                    *chronosDevice,
+                    *shaderLibrary,
+                    *layoutCache,
+                    chronosRenderer->getFramesInFlight(),
+                    settings.shaderDirectory + "cull.comp.spv");
+        }
+    }
+
+    void ChronosApp::cyclePresentMode()
+    {
+        // each present mode with and without low latency; unsupported modes fall back
+        static constexpr VkPresentModeKHR PRESENT_MODES[] = {
+                VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR};
+        constexpr size_t modeCount = sizeof(PRESENT_MODES) / sizeof(PRESENT_MODES[0]);
+
+        size_t current = 0;
+        for (size_t i = 0; i < modeCount; i++) {
+            if (PRESENT_MODES[i] == chronosRenderer->getPreferredPresentMode()) {
+                current = i;
+            }
+        }
+        if (!chronosRenderer->isLowLatency()) {
+            chronosRenderer->setLowLatency(true);
+            return;
+        }
+        chronosRenderer->setLowLatency(false);
+        chronosRenderer->setPresentMode(PRESENT_MODES[(current + 1) % modeCount]);
+    }
+
+    uint32_t ChronosApp::recordingWorkerCount(size_t objectCount) const
+    {
+        size_t byObjects = std::max<size_t>(1, objectCount / MIN_OBJECTS_PER_WORKER);
+        return static_cast<uint32_t>(std::min<size_t>(chronosRenderer->getWorkerCount(), byObjects));
+    }
+
+    uint32_t ChronosApp::renderGameObjects(
+            VkCommandBuffer commandBuffer,
+            const ChronosRenderSnapshot &snapshot,
+            float alpha,
+            uint32_t workerCount)
+    {
+        if (workerCount <= 1) {
+            return recordGameObjects(commandBuffer, snapshot, alpha, 0, snapshot.objects.size());
+        }
+
+        // contiguous partitions keep each worker's draws in submission order
+        std::vector<VkCommandBuffer> secondaryCommandBuffers(workerCount);
+        std::vector<uint32_t> partitionDrawCalls(workerCount);
+        ChronosJobCounter recordingJobs;
+        // Partition i records from worker pool i, whichever thread picks the job up.
+        size_t objectCount = snapshot.objects.size();
+        size_t partitionSize = (objectCount + workerCount - 1) / workerCount;
+        for (uint32_t i = 0; i < workerCount; i++) {
+            size_t begin = std::min(objectCount, i * partitionSize);
+            size_t end = std::min(objectCount, begin + partitionSize);
+            jobSystem.run(
+                    [this, i, begin, end, alpha, &snapshot, &secondaryCommandBuffers, &partitionDrawCalls]() {
+                        VkCommandBuffer secondary = chronosRenderer->beginSecondaryCommandBuffer(i);
+                        partitionDrawCalls[i] = recordGameObjects(secondary, snapshot, alpha, begin, end);
+                        chronosRenderer->endSecondaryCommandBuffer(secondary);
+                        secondaryCommandBuffers[i] = secondary;
+                    },
+                    &recordingJobs);
+        }
+        jobSystem.wait(recordingJobs);
+        uint32_t drawCalls = 0;
+        for (uint32_t partition : partitionDrawCalls) {
+            drawCalls += partition;
+        }
+
+        chronosRenderer->executeSecondaryCommandBuffers(commandBuffer, secondaryCommandBuffers);
+        return drawCalls;
     }
 
-    void ChronosApp::renderGameObjects(VkCommandBuffer commandBuffer)
+    uint32_t ChronosApp::recordGameObjects(
+            VkCommandBuffer commandBuffer,
+            const ChronosRenderSnapshot &snapshot,
+            float alpha,
+            size_t begin,
+            size_t end)
     {
         chronosPipeline->bind(commandBuffer);
 
-        for (auto& obj: gameObjects)
-        {
+        uint32_t drawCalls = 0;
+        for (size_t i = begin; i < end; i++) {
+            const ChronosRenderObject &object = snapshot.objects[i];
+            // still streaming in on the transfer queue
+            if (!object.model->isReady()) continue;
+
             SimplePushConstantData push{};
-            push.offset = obj.transform2d.translation;
-            push.color = obj.color;
-            push.transform = obj.transform2d.mat2();
+            push.offset = object.interpolatedOffset(alpha);
+            push.color = object.color;
+            push.transform = object.interpolatedTransform(alpha);
 
             vkCmdPushConstants(
                     commandBuffer,
@@ -121,9 +643,78 @@ namespace Chronos {
                     0,
                     sizeof(SimplePushConstantData),
                     &push);
-            obj.model->bind(commandBuffer);
-            obj.model->draw(commandBuffer);
-            
+            object.model->bind(commandBuffer);
+            object.model->draw(commandBuffer);
+            drawCalls++;
+        }
+        return drawCalls;
+    }
+
+    uint32_t ChronosApp::renderGameObjectsInstanced(
+            VkCommandBuffer commandBuffer,
+            const ChronosRenderSnapshot &snapshot,
+            float alpha)
+    {
+        // cull on the job system, using the cull shader's test
+        const size_t objectCount = snapshot.objects.size();
+        objectInstanceSlots.resize(objectCount);
+        jobSystem.parallelFor(0, objectCount, MIN_OBJECTS_PER_WORKER, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                const ChronosRenderObject &object = snapshot.objects[i];
+                bool visible = object.model->isReady() &&
+                               ChronosGpuCulling::isOnScreen(
+                                       object.interpolatedTransform(alpha),
+                                       object.interpolatedOffset(alpha),
+                                       object.model->getBoundingRadius());
+                objectInstanceSlots[i] = visible ? 0 : UINT32_MAX;
+            }
+        });
+
+        // group visible objects by model, then lay each group out contiguously
+        instanceBatches.clear();
+        batchLookup.clear();
+        uint32_t instanceCount = 0;
+        for (size_t i = 0; i < objectCount; i++) {
+            if (objectInstanceSlots[i] == UINT32_MAX) continue;
+            ChronosModel *model = snapshot.objects[i].model.get();
+            auto [it, inserted] = batchLookup.try_emplace(model, static_cast<uint32_t>(instanceBatches.size()));
+            if (inserted) {
+                instanceBatches.push_back({model, 0, 0});
+            }
+            // relative to the batch until the batches are laid out
+            objectInstanceSlots[i] = instanceBatches[it->second].instanceCount++;
+            instanceCount++;
+        }
+        if (instanceCount == 0) {
+            return 0;
+        }
+
+        uint32_t firstInstance = 0;
+        for (auto &batch : instanceBatches) {
+            batch.firstInstance = firstInstance;
+            firstInstance += batch.instanceCount;
+        }
+
+        size_t frameIndex = chronosRenderer->getFrameIndex();
+        ChronosInstanceBuffer::InstanceData *instances = instanceBuffer->map(frameIndex, instanceCount);
+        jobSystem.parallelFor(0, objectCount, MIN_OBJECTS_PER_WORKER, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                if (objectInstanceSlots[i] == UINT32_MAX) continue;
+                const ChronosRenderObject &object = snapshot.objects[i];
+                const InstanceBatch &batch = instanceBatches[batchLookup.at(object.model.get())];
+                auto &instance = instances[batch.firstInstance + objectInstanceSlots[i]];
+                instance.transform = object.interpolatedTransform(alpha);
+                instance.offset = object.interpolatedOffset(alpha);
+                instance.color = object.color;
+            }
+        });
+
+        instancedPipeline->bind(commandBuffer);
+        instanceBuffer->bind(commandBuffer, frameIndex);
+        for (auto &batch : instanceBatches) {
+            batch.model->bind(commandBuffer);
+            batch.model->draw(commandBuffer, batch.instanceCount, batch.firstInstance);
         }
+        return static_cast<uint32_t>(instanceBatches.size());
     }
 }
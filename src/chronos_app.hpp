@@ -1,46 +1,256 @@
 #pragma once
 
 #include "chronos_device.hpp"
-#include "chronos_game_object.hpp"
+#include "chronos_components.hpp"
+#include "chronos_ecs.hpp"
+#include "chronos_gpu_culling.hpp"
+#include "chronos_instance_buffer.hpp"
+#include "chronos_job_system.hpp"
 #include "chronos_pipeline.hpp"
+#include "chronos_pipeline_layout_cache.hpp"
+#include "chronos_pipeline_registry.hpp"
+#include "chronos_render_snapshot.hpp"
+#include "chronos_shader_library.hpp"
+#include "chronos_shader_watcher.hpp"
+#include "chronos_transform_hierarchy.hpp"
 #include "chronos_window.hpp"
 #include "chronos_renderer.hpp"
 
 //std
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
 #include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 #include <vulkan/vulkan_core.h>
 
+// set by the build to the source tree's shader directory
+#ifndef CHRONOS_SHADER_DIR
+#define CHRONOS_SHADER_DIR "src/shaders/"
+#endif
+
 namespace Chronos {
     class ChronosApp {
     public:
         static constexpr int WIDTH = 800;
         static constexpr int HEIGHT = 600;
+        // below this many objects per thread, spawning workers costs more than it saves
+        static constexpr size_t MIN_OBJECTS_PER_WORKER = 512;
+
+        enum class RenderPath {
+            PerObject,  // push constants + one draw per object, recorded in parallel
+            Instanced,  // one draw per model from a CPU-filled instance buffer
+            GpuDriven,  // compute culling + one indirect draw per model
+        };
+
+        enum class ThreadingMode {
+            SingleThreaded, // simulate then render each frame on the main thread
+            Pipelined,      // a simulation thread produces frame N+1 while frame N is rendered
+        };
+        // how long the render thread waits for a snapshot before polling events again
+        static constexpr std::chrono::milliseconds SNAPSHOT_WAIT{1};
+        // simulation rate; rendering interpolates between steps
+        static constexpr std::chrono::nanoseconds FIXED_TIMESTEP{1'000'000'000 / 60};
+        // most real time simulated in one go; a longer stall is dropped rather than caught up
+        static constexpr std::chrono::nanoseconds MAX_FRAME_TIME{250'000'000};
+        static constexpr uint32_t STATS_INTERVAL = 1000;
+
+        struct Settings {
+            // renders into an offscreen target with no window or surface
+            bool headless = false;
+            VkExtent2D extent{WIDTH, HEIGHT};
+            RenderPath renderPath = RenderPath::GpuDriven;
+            ThreadingMode threadingMode = ThreadingMode::Pipelined;
+            // frames in flight is fixed here; present mode and low latency can change at runtime
+            ChronosPresentConfig presentConfig{};
+            uint32_t jobWorkers = ChronosJobSystem::defaultWorkerCount();
+            std::string shaderDirectory = CHRONOS_SHADER_DIR;
+            // where the device loads and saves its pipeline cache
+            std::string pipelineCacheDirectory = CHRONOS_PIPELINE_CACHE_DIR;
+            // recompile GLSL in shaderDirectory when it changes and rebuild the affected
+            // pipelines; needs glslc, see ChronosShaderWatcher::defaultCompiler
+            bool hotReloadShaders = false;
+            // print frame, latency and recording stats to stdout every STATS_INTERVAL frames
+            bool printStats = false;
+            // runFrames() waits for the pipelines compiling in the background before its
+            // first frame, so no frame falls back to PerObject, and throws if one failed
+            bool waitForPipelines = false;
+            // After each stats interval, switch to the next present mode and latency mode
+            // combination, so one windowed run reports stats for each of them.
+            bool cyclePresentModes = false;
+            // Replaces the default scene. Called once before the first frame. The job
+            // system can build model data in parallel, see ChronosModel::createModels.
+            std::function<void(ChronosDevice &, ChronosRegistry &, ChronosJobSystem &)> buildScene;
+            // Called every fixed step, on the simulation thread when pipelined.
+            std::function<void(ChronosRegistry &, float dt)> updateScene;
+        };
+
+        struct FrameSample {
+            // end of the previous frame to the end of this one
+            double cpuMilliseconds;
+            double recordMilliseconds;
+            // of an earlier frame, see ChronosRenderer::getGpuMilliseconds
+            double gpuMilliseconds;
+            uint32_t drawCalls;
+            // simulation start of the drawn snapshot to present; negative when this
+            // frame re-presented a snapshot an earlier frame already drew
+            double latencyMilliseconds;
+            // the path drawn with, PerObject while the instanced pipeline is unavailable
+            RenderPath renderPath;
+        };
 
     public:
         ChronosApp();
+        explicit ChronosApp(const Settings &settings);
         ~ChronosApp();
 
         ChronosApp(const ChronosApp &) = delete;
         ChronosApp &operator=(const ChronosApp &) = delete;
 
+        // Renders until the window is closed.
         void run();
+        // Renders frameCount frames, or until the window is closed, and returns
+        // their timings. Works headless. Like run(), call it at most once: stopping
+        // closes the snapshot queue. Both rethrow an exception thrown by a simulation
+        // step, on either thread.
+        std::vector<FrameSample> runFrames(uint32_t frameCount);
+
+        ChronosDevice &getDevice() { return *chronosDevice; }
+        ChronosRenderer &getRenderer() { return *chronosRenderer; }
+        // counts from the latest finished GPU-driven frame; zero on the other render paths
+        ChronosGpuCulling::Stats getCullingStats() const
+        {
+            return gpuCulling ? gpuCulling->getStats() : ChronosGpuCulling::Stats{};
+        }
+
     private:
         void loadGameObjects();
         void createPipelineLayout();
         void createPipeline();
-        void renderGameObjects(VkCommandBuffer commandBuffer);
+        void configurePipeline(PipelineConfigInfo &configInfo, bool instanced);
+        void requestInstancedPipeline();
+        // True if the shaders merge to pipelineLayout. The descriptor sets and push
+        // constants are made for that layout, so a reload that changes it is refused.
+        bool fitsPipelineLayout(const std::vector<std::string> &shaderNames);
+        // Swaps in pending's pipeline once compiled, retiring the one it replaces. A
+        // failed compile is logged and leaves pipeline as it was, possibly null.
+        void adoptReadyPipeline(
+                std::shared_ptr<ChronosPipeline> &pipeline,
+                ChronosPipelineRegistry::PipelineFuture &pending);
+        // Blocks until the pending pipelines are adopted. Throws if one failed to compile.
+        void waitForPipelines();
+        // Runs between frames. Rebuilds only the pipelines using recompiled shaders.
+        void reloadChangedShaders();
+        // Advances gameplay by one fixed step. Changes must go through registry.patch()
+        // so snapshots pick them up. Runs on the simulation thread when pipelined.
+        void update(float dt);
+        void runSimulationStep();
+        // Returns false once snapshots are closed.
+        bool publishSnapshot(
+                std::chrono::steady_clock::time_point simulationStart,
+                std::chrono::steady_clock::time_point tickTime);
+        void simulationLoop();
+        void startSimulation();
+        // Stops the simulation thread and waits for the GPU.
+        void stopSimulation();
+        // Simulates when single-threaded, then draws the latest snapshot. Expects
+        // waitForNextFrame() and input polling to have happened. Returns whether a
+        // frame was submitted.
+        bool drawFrame();
+        uint32_t recordingWorkerCount(size_t objectCount) const;
+        void cyclePresentMode();
+        // each returns the number of draw calls recorded
+        uint32_t renderGameObjects(
+                VkCommandBuffer commandBuffer,
+                const ChronosRenderSnapshot &snapshot,
+                float alpha,
+                uint32_t workerCount);
+        uint32_t recordGameObjects(
+                VkCommandBuffer commandBuffer,
+                const ChronosRenderSnapshot &snapshot,
+                float alpha,
+                size_t begin,
+                size_t end);
+        uint32_t renderGameObjectsInstanced(
+                VkCommandBuffer commandBuffer,
+                const ChronosRenderSnapshot &snapshot,
+                float alpha);
 
     private:
-        ChronosWindow chronosWindow{WIDTH, HEIGHT, "HELLO VULKAN!"};
-        ChronosDevice chronosDevice{chronosWindow};
-        ChronosRenderer chronosRenderer{chronosWindow, chronosDevice};
+        Settings settings;
+        // declared first so workers outlive everything their jobs touch
+        ChronosJobSystem jobSystem;
+        // no window when headless
+        std::unique_ptr<ChronosWindow> chronosWindow;
+        std::unique_ptr<ChronosDevice> chronosDevice;
+        std::unique_ptr<ChronosRenderer> chronosRenderer;
 
         std::unique_ptr<ChronosSwapChain> chronosSwapChain;
-        std::unique_ptr<ChronosPipeline> chronosPipeline;
-        VkPipelineLayout pipelineLayout;
+        std::unique_ptr<ChronosShaderLibrary> shaderLibrary;
+        std::unique_ptr<ChronosPipelineLayoutCache> layoutCache;
+        std::unique_ptr<ChronosPipelineRegistry> pipelineRegistry;
+        std::unique_ptr<ChronosShaderWatcher> shaderWatcher;
+        std::shared_ptr<ChronosPipeline> chronosPipeline;
+        ChronosPipelineRegistry::PipelineFuture pendingPipeline;
+        // null until pendingInstancedPipeline has compiled
+        std::shared_ptr<ChronosPipeline> instancedPipeline;
+        ChronosPipelineRegistry::PipelineFuture pendingInstancedPipeline;
+        std::unique_ptr<ChronosInstanceBuffer> instanceBuffer;
+        // null unless settings.renderPath is GpuDriven
+        std::unique_ptr<ChronosGpuCulling> gpuCulling;
+        // owned by layoutCache
+        VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
         std::vector<VkCommandBuffer> commandBuffers;
-        std::vector<ChronosGameObject> gameObjects;
+        // owned by the simulation thread while pipelined; the renderer only sees snapshots
+        ChronosRegistry registry;
+        ChronosTransformHierarchy transformHierarchy;
+        ChronosSnapshotQueue snapshotQueue;
+        std::thread simulationThread;
+        std::atomic<bool> simulationRunning{false};
+        // what stopped the simulation thread, rethrown by the next drawFrame
+        std::exception_ptr simulationError;
+        std::atomic<bool> simulationFailed{false};
+
+        // Kept until a newer snapshot is queued and redrawn with a later alpha meanwhile.
+        // A snapshot is only let go once recorded, so the GPU path sees every change.
+        const ChronosRenderSnapshot *currentSnapshot = nullptr;
+        bool snapshotRecorded = false;
+        bool drawingFrame = false;
+        std::chrono::steady_clock::time_point previousFrame{};
+        FrameSample lastFrameSample{};
+        // single-threaded only: real time not yet simulated
+        std::chrono::steady_clock::time_point previousStep{};
+        std::chrono::nanoseconds stepAccumulator{0};
+
+        struct InstanceBatch {
+            ChronosModel *model;
+            uint32_t firstInstance;
+            uint32_t instanceCount;
+        };
+        std::vector<InstanceBatch> instanceBatches;
+        // instance slot of each snapshot object, UINT32_MAX when culled or not ready
+        std::vector<uint32_t> objectInstanceSlots;
+        std::unordered_map<ChronosModel *, uint32_t> batchLookup;
+
+        double recordingMilliseconds = 0.0;
+        // simulation start to the frame being handed to present, once per snapshot
+        double latencyMilliseconds = 0.0;
+        uint32_t latencySamples = 0;
+        double minFrameMilliseconds = 0.0;
+        double maxFrameMilliseconds = 0.0;
+        uint64_t recordedDrawCalls = 0;
+        uint32_t recordedFrames = 0;
+        std::chrono::steady_clock::time_point statsStart{};
+        // written by the simulation thread
+        std::atomic<uint64_t> simulationSteps{0};
+        std::atomic<uint64_t> simulationNanoseconds{0};
+        std::atomic<uint64_t> droppedStalls{0};
 
     };
 }
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "chronos_ecs.hpp"
+#include "chronos_model.hpp"
+
+//std
+#include <memory>
+
+namespace Chronos {
+
+struct Transform2dComponent {
+    glm::vec2 translation{}; //position offset
+    glm::vec2 scale{1.f,1.f};
+    float rotation = 0.f;
+
+    glm::mat2 mat2() const
+    {
+        const float s = glm::sin(rotation);
+        const float c = glm::cos(rotation);
+        glm::mat2 rotMatrix{{c,s}, {-s,c}};
+
+        glm::mat2 scaleMat{{scale.x, .0f}, {0.f, scale.y}};
+        return rotMatrix * scaleMat;
+    }
+};
+
+// Makes the entity's Transform2dComponent relative to the parent's world transform.
+// Change parents through ChronosRegistry::patch() so the hierarchy is rebuilt.
+struct ParentComponent {
+    ChronosEntity parent{};
+};
+
+struct ColorComponent {
+    glm::vec3 color{};
+};
+
+struct ModelComponent {
+    std::shared_ptr<ChronosModel> model{};
+};
+
+}
@@ -1,7 +1,11 @@
 #include "chronos_device.hpp"
+#include "chronos_staging_ring.hpp"
+#include "chronos_utils.hpp"
 
 // std headers
 #include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <set>
 #include <unordered_set>
@@ -47,24 +51,43 @@ void DestroyDebugUtilsMessengerEXT(
 }
 
 // class member functions
-ChronosDevice::ChronosDevice(ChronosWindow &window) : window{window} {
+ChronosDevice::ChronosDevice(ChronosWindow &window, std::string pipelineCacheDirectory)
+    : window{&window}, pipelineCacheDirectory{std::move(pipelineCacheDirectory)} {
+  init();
+}
+
+ChronosDevice::ChronosDevice(std::string pipelineCacheDirectory)
+    : pipelineCacheDirectory{std::move(pipelineCacheDirectory)} {
+  init();
+}
+
+void ChronosDevice::init() {
   createInstance();
   setupDebugMessenger();
   createSurface();
   pickPhysicalDevice();
   createLogicalDevice();
+  allocator = std::make_unique<ChronosAllocator>(device_, physicalDevice);
   createCommandPool();
+  createPipelineCache();
+  stagingRing_ = std::make_unique<ChronosStagingRing>(*this);
 }
 
 ChronosDevice::~ChronosDevice() {
+  stagingRing_.reset();
+  savePipelineCache();
+  vkDestroyPipelineCache(device_, pipelineCache_, nullptr);
   vkDestroyCommandPool(device_, commandPool, nullptr);
+  allocator.reset();
   vkDestroyDevice(device_, nullptr);
 
   if (enableValidationLayers) {
     DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
   }
 
-  vkDestroySurfaceKHR(instance, surface_, nullptr);
+  if (surface_ != VK_NULL_HANDLE) {
+    vkDestroySurfaceKHR(instance, surface_, nullptr);
+  }
   vkDestroyInstance(instance, nullptr);
 }
 
@@ -137,7 +160,10 @@ void ChronosDevice::createLogicalDevice() {
   QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
 
   std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-  std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily, indices.presentFamily};
+  std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily, indices.transferFamily};
+  if (indices.presentFamilyHasValue) {
+    uniqueQueueFamilies.insert(indices.presentFamily);
+  }
 
   float queuePriority = 1.0f;
   for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -159,6 +185,7 @@ void ChronosDevice::createLogicalDevice() {
   createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
   createInfo.pEnabledFeatures = &deviceFeatures;
+  auto deviceExtensions = getRequiredDeviceExtensions();
   createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
   createInfo.ppEnabledExtensionNames = deviceExtensions.data();
 
@@ -176,7 +203,10 @@ void ChronosDevice::createLogicalDevice() {
   }
 
   vkGetDeviceQueue(device_, indices.graphicsFamily, 0, &graphicsQueue_);
-  vkGetDeviceQueue(device_, indices.presentFamily, 0, &presentQueue_);
+  if (indices.presentFamilyHasValue) {
+    vkGetDeviceQueue(device_, indices.presentFamily, 0, &presentQueue_);
+  }
+  vkGetDeviceQueue(device_, indices.transferFamily, 0, &transferQueue_);
 }
 
 void ChronosDevice::createCommandPool() {
@@ -193,15 +223,98 @@ void ChronosDevice::createCommandPool() {
   }
 }
 
-void ChronosDevice::createSurface() { window.createWindowSurface(instance, &surface_); }
+void ChronosDevice::createPipelineCache() {
+  std::vector<char> initialData;
+  std::ifstream file{pipelineCachePath(), std::ios::ate | std::ios::binary};
+  if (file.is_open()) {
+    initialData.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(initialData.data(), initialData.size());
+    if (!file || !isPipelineCacheCompatible(initialData)) {
+      std::cout << "Discarding stale pipeline cache" << std::endl;
+      initialData.clear();
+    }
+  }
+
+  VkPipelineCacheCreateInfo cacheInfo = {};
+  cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+  cacheInfo.initialDataSize = initialData.size();
+  cacheInfo.pInitialData = initialData.empty() ? nullptr : initialData.data();
+
+  if (vkCreatePipelineCache(device_, &cacheInfo, nullptr, &pipelineCache_) != VK_SUCCESS) {
+    // the driver may still reject data that passed our header check
+    cacheInfo.initialDataSize = 0;
+    cacheInfo.pInitialData = nullptr;
+    initialData.clear();
+    if (vkCreatePipelineCache(device_, &cacheInfo, nullptr, &pipelineCache_) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create pipeline cache!");
+    }
+  }
+  pipelineCacheWarm = !initialData.empty();
+}
+
+void ChronosDevice::savePipelineCache() {
+  size_t dataSize = 0;
+  if (vkGetPipelineCacheData(device_, pipelineCache_, &dataSize, nullptr) != VK_SUCCESS ||
+      dataSize == 0) {
+    return;
+  }
+  std::vector<char> data(dataSize);
+  if (vkGetPipelineCacheData(device_, pipelineCache_, &dataSize, data.data()) != VK_SUCCESS) {
+    return;
+  }
+
+  // write to a temporary and rename over the old file so a crash never leaves a torn cache
+  std::string path = pipelineCachePath();
+  std::string tempPath = path + ".tmp";
+  {
+    std::ofstream file{tempPath, std::ios::binary | std::ios::trunc};
+    file.write(data.data(), dataSize);
+    if (!file) {
+      std::cerr << "failed to write pipeline cache: " << tempPath << std::endl;
+      std::error_code ignored;
+      std::filesystem::remove(tempPath, ignored);
+      return;
+    }
+  }
+  if (std::error_code error = replaceFile(tempPath, path)) {
+    std::cerr << "failed to replace pipeline cache: " << path << " (" << error.message() << ")" << std::endl;
+  }
+}
+
+std::string ChronosDevice::pipelineCachePath() {
+  std::string name = "pipeline_cache_" + std::to_string(properties.vendorID) + "_" +
+                     std::to_string(properties.deviceID) + ".bin";
+  return (std::filesystem::path{pipelineCacheDirectory} / name).string();
+}
+
+bool ChronosDevice::isPipelineCacheCompatible(const std::vector<char> &data) {
+  // VkPipelineCacheHeaderVersionOne: headerSize, headerVersion, vendorID, deviceID, UUID
+  const size_t headerSize = 16 + VK_UUID_SIZE;
+  if (data.size() < headerSize) {
+    return false;
+  }
+
+  uint32_t header[4];
+  memcpy(header, data.data(), sizeof(header));
+  return header[0] >= headerSize && header[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+         header[2] == properties.vendorID && header[3] == properties.deviceID &&
+         memcmp(data.data() + 16, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+void ChronosDevice::createSurface() {
+  if (window != nullptr) {
+    window->createWindowSurface(instance, &surface_);
+  }
+}
 
 bool ChronosDevice::isDeviceSuitable(VkPhysicalDevice device) {
   QueueFamilyIndices indices = findQueueFamilies(device);
 
   bool extensionsSupported = checkDeviceExtensionSupport(device);
 
-  bool swapChainAdequate = false;
-  if (extensionsSupported) {
+  bool swapChainAdequate = isHeadless();
+  if (extensionsSupported && !isHeadless()) {
     SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
     swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
   }
@@ -209,7 +322,8 @@ bool ChronosDevice::isDeviceSuitable(VkPhysicalDevice device) {
   VkPhysicalDeviceFeatures supportedFeatures;
   vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
 
-  return indices.isComplete() && extensionsSupported && swapChainAdequate &&
+  bool queuesComplete = isHeadless() ? indices.graphicsFamilyHasValue : indices.isComplete();
+  return queuesComplete && extensionsSupported && swapChainAdequate &&
          supportedFeatures.samplerAnisotropy;
 }
 
@@ -261,11 +375,13 @@ bool ChronosDevice::checkValidationLayerSupport() {
 }
 
 std::vector<const char *> ChronosDevice::getRequiredExtensions() {
-  uint32_t glfwExtensionCount = 0;
-  const char **glfwExtensions;
-  glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-
-  std::vector<const char *> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+  std::vector<const char *> extensions;
+  if (!isHeadless()) {
+    uint32_t glfwExtensionCount = 0;
+    const char **glfwExtensions;
+    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+    extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+  }
 
   if (enableValidationLayers) {
     extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -308,6 +424,7 @@ bool ChronosDevice::checkDeviceExtensionSupport(VkPhysicalDevice device) {
       &extensionCount,
       availableExtensions.data());
 
+  auto deviceExtensions = getRequiredDeviceExtensions();
   std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
 
   for (const auto &extension : availableExtensions) {
@@ -317,6 +434,13 @@ bool ChronosDevice::checkDeviceExtensionSupport(VkPhysicalDevice device) {
   return requiredExtensions.empty();
 }
 
+std::vector<const char *> ChronosDevice::getRequiredDeviceExtensions() {
+  if (isHeadless()) {
+    return {};
+  }
+  return {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+}
+
 QueueFamilyIndices ChronosDevice::findQueueFamilies(VkPhysicalDevice device) {
   QueueFamilyIndices indices;
 
@@ -326,25 +450,51 @@ QueueFamilyIndices ChronosDevice::findQueueFamilies(VkPhysicalDevice device) {
   std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
   vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
 
+  // prefer a transfer-only family (DMA engine), then any non-graphics family that can transfer
+  int transferScore = -1;
   int i = 0;
   for (const auto &queueFamily : queueFamilies) {
-    if (queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+    if (queueFamily.queueCount == 0) {
+      i++;
+      continue;
+    }
+    if (!indices.graphicsFamilyHasValue && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
       indices.graphicsFamily = i;
       indices.graphicsFamilyHasValue = true;
     }
     VkBool32 presentSupport = false;
-    vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
-    if (queueFamily.queueCount > 0 && presentSupport) {
+    if (surface_ != VK_NULL_HANDLE) {
+      vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
+    }
+    if (!indices.presentFamilyHasValue && presentSupport) {
       indices.presentFamily = i;
       indices.presentFamilyHasValue = true;
     }
-    if (indices.isComplete()) {
-      break;
+
+    bool graphics = queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT;
+    bool compute = queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT;
+    bool transfer = queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT;
+    int score = -1;
+    if (transfer && !graphics && !compute) {
+      score = 2;
+    } else if (transfer && !graphics) {
+      score = 1;
+    }
+    if (score > transferScore) {
+      indices.transferFamily = i;
+      indices.transferFamilyHasValue = true;
+      transferScore = score;
     }
 
     i++;
   }
 
+  // graphics queues always support transfers
+  if (!indices.transferFamilyHasValue && indices.graphicsFamilyHasValue) {
+    indices.transferFamily = indices.graphicsFamily;
+    indices.transferFamilyHasValue = true;
+  }
+
   return indices;
 }
 
@@ -408,7 +558,7 @@ void ChronosDevice::createBuffer(
     VkBufferUsageFlags usage,
     VkMemoryPropertyFlags properties,
     VkBuffer &buffer,
-    VkDeviceMemory &bufferMemory) {
+    ChronosAllocation &bufferAllocation) {
   VkBufferCreateInfo bufferInfo{};
   bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
   bufferInfo.size = size;
@@ -422,16 +572,20 @@ void ChronosDevice::createBuffer(
   VkMemoryRequirements memRequirements;
   vkGetBufferMemoryRequirements(device_, buffer, &memRequirements);
 
-  VkMemoryAllocateInfo allocInfo{};
-  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  allocInfo.allocationSize = memRequirements.size;
-  allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+  bufferAllocation = allocator->allocate(
+      memRequirements,
+      findMemoryType(memRequirements.memoryTypeBits, properties),
+      true);
 
-  if (vkAllocateMemory(device_, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-    throw std::runtime_error("failed to allocate vertex buffer memory!");
+  if (vkBindBufferMemory(device_, buffer, bufferAllocation.memory, bufferAllocation.offset) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("failed to bind buffer memory!");
   }
+}
 
-  vkBindBufferMemory(device_, buffer, bufferMemory, 0);
+void ChronosDevice::destroyBuffer(VkBuffer buffer, ChronosAllocation &bufferAllocation) {
+  vkDestroyBuffer(device_, buffer, nullptr);
+  allocator->free(bufferAllocation);
 }
 
 VkCommandBuffer ChronosDevice::beginSingleTimeCommands() {
@@ -460,9 +614,18 @@ void ChronosDevice::endSingleTimeCommands(VkCommandBuffer commandBuffer) {
   submitInfo.commandBufferCount = 1;
   submitInfo.pCommandBuffers = &commandBuffer;
 
-  vkQueueSubmit(graphicsQueue_, 1, &submitInfo, VK_NULL_HANDLE);
-  vkQueueWaitIdle(graphicsQueue_);
+  // wait on this submission only, not on everything else queued on graphicsQueue_
+  VkFenceCreateInfo fenceInfo{};
+  fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+  VkFence fence;
+  if (vkCreateFence(device_, &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create single time command fence!");
+  }
+
+  vkQueueSubmit(graphicsQueue_, 1, &submitInfo, fence);
+  vkWaitForFences(device_, 1, &fence, VK_TRUE, UINT64_MAX);
 
+  vkDestroyFence(device_, fence, nullptr);
   vkFreeCommandBuffers(device_, commandPool, 1, &commandBuffer);
 }
 
@@ -509,7 +672,7 @@ void ChronosDevice::createImageWithInfo(
     const VkImageCreateInfo &imageInfo,
     VkMemoryPropertyFlags properties,
     VkImage &image,
-    VkDeviceMemory &imageMemory) {
+    ChronosAllocation &imageAllocation) {
   if (vkCreateImage(device_, &imageInfo, nullptr, &image) != VK_SUCCESS) {
     throw std::runtime_error("failed to create image!");
   }
@@ -517,18 +680,20 @@ void ChronosDevice::createImageWithInfo(
   VkMemoryRequirements memRequirements;
   vkGetImageMemoryRequirements(device_, image, &memRequirements);
 
-  VkMemoryAllocateInfo allocInfo{};
-  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  allocInfo.allocationSize = memRequirements.size;
-  allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-  if (vkAllocateMemory(device_, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-    throw std::runtime_error("failed to allocate image memory!");
-  }
+  imageAllocation = allocator->allocate(
+      memRequirements,
+      findMemoryType(memRequirements.memoryTypeBits, properties),
+      imageInfo.tiling == VK_IMAGE_TILING_LINEAR);
 
-  if (vkBindImageMemory(device_, image, imageMemory, 0) != VK_SUCCESS) {
+  if (vkBindImageMemory(device_, image, imageAllocation.memory, imageAllocation.offset) !=
+      VK_SUCCESS) {
     throw std::runtime_error("failed to bind image memory!");
   }
 }
 
+void ChronosDevice::destroyImage(VkImage image, ChronosAllocation &imageAllocation) {
+  vkDestroyImage(device_, image, nullptr);
+  allocator->free(imageAllocation);
+}
+
 }  // namespace lve
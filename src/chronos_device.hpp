@@ -1,13 +1,22 @@
 #pragma once
 
+#include "chronos_allocator.hpp"
 #include "chronos_window.hpp"
 
 // std lib headers
+#include <memory>
 #include <string>
 #include <vector>
 
+// set by the build to its binary directory; the working directory otherwise
+#ifndef CHRONOS_PIPELINE_CACHE_DIR
+#define CHRONOS_PIPELINE_CACHE_DIR ""
+#endif
+
 namespace Chronos {
 
+class ChronosStagingRing;
+
 struct SwapChainSupportDetails {
   VkSurfaceCapabilitiesKHR capabilities;
   std::vector<VkSurfaceFormatKHR> formats;
@@ -17,9 +26,13 @@ struct SwapChainSupportDetails {
 struct QueueFamilyIndices {
   uint32_t graphicsFamily;
   uint32_t presentFamily;
+  uint32_t transferFamily;
   bool graphicsFamilyHasValue = false;
   bool presentFamilyHasValue = false;
+  bool transferFamilyHasValue = false;
   bool isComplete() { return graphicsFamilyHasValue && presentFamilyHasValue; }
+  // false when transfers fall back to the graphics queue
+  bool hasDedicatedTransfer() { return transferFamilyHasValue && transferFamily != graphicsFamily; }
 };
 
 class ChronosDevice {
@@ -30,7 +43,10 @@ class ChronosDevice {
   const bool enableValidationLayers = true;
 #endif
 
-  ChronosDevice(ChronosWindow &window);
+  // The pipeline cache is loaded from and saved to pipelineCacheDirectory.
+  ChronosDevice(ChronosWindow &window, std::string pipelineCacheDirectory = CHRONOS_PIPELINE_CACHE_DIR);
+  // headless: no surface, swap chain extension or present queue
+  explicit ChronosDevice(std::string pipelineCacheDirectory = CHRONOS_PIPELINE_CACHE_DIR);
   ~ChronosDevice();
 
   // Not copyable or movable
@@ -39,11 +55,17 @@ class ChronosDevice {
   ChronosDevice(ChronosDevice &&) = delete;
   ChronosDevice& operator=(ChronosDevice &&) = delete;
 
+  bool isHeadless() { return window == nullptr; }
   VkCommandPool getCommandPool() { return commandPool; }
   VkDevice device() { return device_; }
   VkSurfaceKHR surface() { return surface_; }
   VkQueue graphicsQueue() { return graphicsQueue_; }
+  // VK_NULL_HANDLE when headless
   VkQueue presentQueue() { return presentQueue_; }
+  VkQueue transferQueue() { return transferQueue_; }
+  VkPipelineCache pipelineCache() { return pipelineCache_; }
+  // true when the pipeline cache was seeded from a valid file on disk
+  bool isPipelineCacheWarm() { return pipelineCacheWarm; }
 
   SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(physicalDevice); }
   uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
@@ -57,7 +79,8 @@ class ChronosDevice {
       VkBufferUsageFlags usage,
       VkMemoryPropertyFlags properties,
       VkBuffer &buffer,
-      VkDeviceMemory &bufferMemory);
+      ChronosAllocation &bufferAllocation);
+  void destroyBuffer(VkBuffer buffer, ChronosAllocation &bufferAllocation);
   VkCommandBuffer beginSingleTimeCommands();
   void endSingleTimeCommands(VkCommandBuffer commandBuffer);
   void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
@@ -68,17 +91,24 @@ class ChronosDevice {
       const VkImageCreateInfo &imageInfo,
       VkMemoryPropertyFlags properties,
       VkImage &image,
-      VkDeviceMemory &imageMemory);
+      ChronosAllocation &imageAllocation);
+  void destroyImage(VkImage image, ChronosAllocation &imageAllocation);
+
+  ChronosAllocatorStats getAllocatorStats() { return allocator->getStats(); }
+  ChronosStagingRing &stagingRing() { return *stagingRing_; }
 
   VkPhysicalDeviceProperties properties;
 
  private:
+  void init();
   void createInstance();
   void setupDebugMessenger();
   void createSurface();
   void pickPhysicalDevice();
   void createLogicalDevice();
   void createCommandPool();
+  void createPipelineCache();
+  void savePipelineCache();
 
   // helper functions
   bool isDeviceSuitable(VkPhysicalDevice device);
@@ -88,21 +118,30 @@ class ChronosDevice {
   void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT &createInfo);
   void hasGflwRequiredInstanceExtensions();
   bool checkDeviceExtensionSupport(VkPhysicalDevice device);
+  std::vector<const char *> getRequiredDeviceExtensions();
   SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
+  std::string pipelineCachePath();
+  bool isPipelineCacheCompatible(const std::vector<char> &data);
 
   VkInstance instance;
   VkDebugUtilsMessengerEXT debugMessenger;
   VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
-  ChronosWindow &window;
+  ChronosWindow *window = nullptr;
   VkCommandPool commandPool;
 
   VkDevice device_;
-  VkSurfaceKHR surface_;
+  VkSurfaceKHR surface_ = VK_NULL_HANDLE;
   VkQueue graphicsQueue_;
-  VkQueue presentQueue_;
+  VkQueue presentQueue_ = VK_NULL_HANDLE;
+  VkQueue transferQueue_;
+  std::string pipelineCacheDirectory;
+  VkPipelineCache pipelineCache_ = VK_NULL_HANDLE;
+  bool pipelineCacheWarm = false;
+
+  std::unique_ptr<ChronosAllocator> allocator;
+  std::unique_ptr<ChronosStagingRing> stagingRing_;
 
   const std::vector<const char *> validationLayers = {"VK_LAYER_KHRONOS_validation"};
-  const std::vector<const char *> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
 };
 
 }  // namespace lve
@@ -0,0 +1,348 @@
+#pragma once
+
+//std
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace Chronos {
+
+    // Index into the registry's slot table plus the generation the slot had when the
+    // entity was created, so handles to destroyed entities never alias new ones.
+    struct ChronosEntity {
+        static constexpr uint32_t INVALID_INDEX = std::numeric_limits<uint32_t>::max();
+
+        uint32_t index = INVALID_INDEX;
+        uint32_t generation = 0;
+
+        bool operator==(const ChronosEntity &other) const
+        {
+            return index == other.index && generation == other.generation;
+        }
+        bool operator!=(const ChronosEntity &other) const { return !(*this == other); }
+    };
+
+    // Sparse set: components live densely packed in insertion order and are
+    // swap-removed, so iteration is a linear walk over contiguous memory.
+    //
+    // Pools also record which dense slots changed since the last clearDirty():
+    // added components, components moved by a swap-remove, and anything written
+    // through ChronosRegistry::patch(). Writes through get() are not tracked.
+    class ChronosComponentPoolBase {
+    public:
+        virtual ~ChronosComponentPoolBase() = default;
+        virtual void remove(ChronosEntity entity) = 0;
+        virtual void clearDirty() = 0;
+
+        // bumped on every add and remove, so consumers can tell when to rebuild
+        uint64_t getStructureVersion() const { return structureVersion; }
+
+    protected:
+        uint64_t structureVersion = 0;
+    };
+
+    template <typename Component>
+    class ChronosComponentPool : public ChronosComponentPoolBase {
+    public:
+        bool contains(ChronosEntity entity) const
+        {
+            return entity.index < sparse.size() && sparse[entity.index] != ChronosEntity::INVALID_INDEX &&
+                   entities[sparse[entity.index]] == entity;
+        }
+
+        Component &add(ChronosEntity entity, Component component)
+        {
+            assert(!contains(entity) && "Entity already has this component");
+            if (entity.index >= sparse.size()) {
+                sparse.resize(entity.index + 1, ChronosEntity::INVALID_INDEX);
+            }
+            sparse[entity.index] = static_cast<uint32_t>(dense.size());
+            entities.push_back(entity);
+            dense.push_back(std::move(component));
+            dirtyFlags.push_back(0);
+            markDirtyAt(dense.size() - 1);
+            structureVersion++;
+            return dense.back();
+        }
+
+        void remove(ChronosEntity entity) override
+        {
+            if (!contains(entity)) {
+                return;
+            }
+            uint32_t denseIndex = sparse[entity.index];
+            uint32_t lastIndex = static_cast<uint32_t>(dense.size() - 1);
+            if (denseIndex != lastIndex) {
+                dense[denseIndex] = std::move(dense[lastIndex]);
+                entities[denseIndex] = entities[lastIndex];
+                sparse[entities[denseIndex].index] = denseIndex;
+                markDirtyAt(denseIndex);
+            }
+            dense.pop_back();
+            entities.pop_back();
+            dirtyFlags.pop_back();
+            sparse[entity.index] = ChronosEntity::INVALID_INDEX;
+            structureVersion++;
+        }
+
+        void markDirty(ChronosEntity entity)
+        {
+            assert(contains(entity) && "Entity does not have this component");
+            markDirtyAt(sparse[entity.index]);
+        }
+
+        void markAllDirty()
+        {
+            for (size_t i = 0; i < dense.size(); i++) {
+                markDirtyAt(i);
+            }
+        }
+
+        // Dense slots changed since the last clearDirty(). May hold duplicates and
+        // slots past size() left behind by removals; skip those.
+        const std::vector<uint32_t> &getDirtyIndices() const { return dirtyIndices; }
+
+        void clearDirty() override
+        {
+            for (uint32_t index : dirtyIndices) {
+                if (index < dirtyFlags.size()) {
+                    dirtyFlags[index] = 0;
+                }
+            }
+            dirtyIndices.clear();
+        }
+
+        Component &get(ChronosEntity entity)
+        {
+            assert(contains(entity) && "Entity does not have this component");
+            return dense[sparse[entity.index]];
+        }
+
+        // nullptr when the entity has no such component
+        Component *find(ChronosEntity entity)
+        {
+            return contains(entity) ? &dense[sparse[entity.index]] : nullptr;
+        }
+
+        size_t size() const { return dense.size(); }
+        Component *data() { return dense.data(); }
+        // dense position of a component reference obtained from this pool
+        size_t indexOf(const Component &component) const
+        {
+            return static_cast<size_t>(&component - dense.data());
+        }
+        ChronosEntity entityAt(size_t denseIndex) const { return entities[denseIndex]; }
+        Component &componentAt(size_t denseIndex) { return dense[denseIndex]; }
+
+        // Lookup for iteration. Pools filled in the same order share dense indices, so the
+        // hinted slot is checked first and the sparse table only consulted on a miss.
+        Component *findHinted(ChronosEntity entity, size_t hint)
+        {
+            if (hint < entities.size() && entities[hint] == entity) {
+                return &dense[hint];
+            }
+            return find(entity);
+        }
+
+    private:
+        void markDirtyAt(size_t denseIndex)
+        {
+            if (!dirtyFlags[denseIndex]) {
+                dirtyFlags[denseIndex] = 1;
+                dirtyIndices.push_back(static_cast<uint32_t>(denseIndex));
+            }
+        }
+
+        std::vector<uint32_t> sparse;
+        std::vector<ChronosEntity> entities;
+        std::vector<Component> dense;
+        std::vector<uint8_t> dirtyFlags;
+        std::vector<uint32_t> dirtyIndices;
+    };
+
+    class ChronosRegistry;
+
+    // Iterates every entity that has all of Components. The first component type
+    // drives iteration, so list the rarest one first.
+    template <typename Lead, typename... Rest>
+    class ChronosView {
+    public:
+        // upper bound on the number of matching entities; ranges for each() are in this space
+        size_t size() const { return lead->size(); }
+
+        template <typename Func>
+        void each(Func &&func) const
+        {
+            each(0, size(), std::forward<Func>(func));
+        }
+
+        // func(ChronosEntity, Lead &, Rest &...) for matches among lead slots [begin, end).
+        // Disjoint ranges may be walked from different threads.
+        template <typename Func>
+        void each(size_t begin, size_t end, Func &&func) const
+        {
+            for (size_t i = begin; i < end; i++) {
+                ChronosEntity entity = lead->entityAt(i);
+                std::tuple<Rest *...> others{std::get<ChronosComponentPool<Rest> *>(rest)->findHinted(entity, i)...};
+                if (!allFound(others, std::index_sequence_for<Rest...>{})) {
+                    continue;
+                }
+                std::apply(
+                        [&](Rest *...components) { func(entity, lead->componentAt(i), *components...); },
+                        others);
+            }
+        }
+
+    private:
+        friend class ChronosRegistry;
+
+        ChronosView(ChronosComponentPool<Lead> *lead, ChronosComponentPool<Rest> *...rest)
+            : lead{lead}, rest{rest...}
+        {
+        }
+
+        template <size_t... I>
+        static bool allFound(const std::tuple<Rest *...> &others, std::index_sequence<I...>)
+        {
+            return ((std::get<I>(others) != nullptr) && ...);
+        }
+
+        ChronosComponentPool<Lead> *lead;
+        std::tuple<ChronosComponentPool<Rest> *...> rest;
+    };
+
+    class ChronosRegistry {
+    public:
+        ChronosRegistry() = default;
+
+        ChronosRegistry(const ChronosRegistry &) = delete;
+        ChronosRegistry &operator=(const ChronosRegistry &) = delete;
+
+        ChronosEntity create()
+        {
+            ChronosEntity entity;
+            if (!freeIndices.empty()) {
+                entity.index = freeIndices.back();
+                freeIndices.pop_back();
+            } else {
+                entity.index = static_cast<uint32_t>(generations.size());
+                generations.push_back(0);
+            }
+            entity.generation = generations[entity.index];
+            aliveCount++;
+            return entity;
+        }
+
+        void destroy(ChronosEntity entity)
+        {
+            if (!isAlive(entity)) {
+                return;
+            }
+            for (auto &pool : pools) {
+                if (pool) {
+                    pool->remove(entity);
+                }
+            }
+            generations[entity.index]++;
+            freeIndices.push_back(entity.index);
+            aliveCount--;
+        }
+
+        bool isAlive(ChronosEntity entity) const
+        {
+            return entity.index < generations.size() && generations[entity.index] == entity.generation;
+        }
+
+        size_t size() const { return aliveCount; }
+
+        template <typename Component>
+        Component &add(ChronosEntity entity, Component component = {})
+        {
+            assert(isAlive(entity) && "Cannot add a component to a destroyed entity");
+            return pool<Component>().add(entity, std::move(component));
+        }
+
+        template <typename Component>
+        void remove(ChronosEntity entity)
+        {
+            pool<Component>().remove(entity);
+        }
+
+        // The way to modify a component so that change consumers see it:
+        // registry.patch<Transform2dComponent>(entity, [](auto &t) { t.rotation += dt; });
+        template <typename Component, typename Func>
+        Component &patch(ChronosEntity entity, Func &&func)
+        {
+            auto &componentPool = pool<Component>();
+            Component &component = componentPool.get(entity);
+            func(component);
+            componentPool.markDirty(entity);
+            return component;
+        }
+
+        // Call once every consumer has seen this frame's changes.
+        void clearDirty()
+        {
+            for (auto &pool : pools) {
+                if (pool) {
+                    pool->clearDirty();
+                }
+            }
+        }
+
+        template <typename Component>
+        bool has(ChronosEntity entity)
+        {
+            return pool<Component>().contains(entity);
+        }
+
+        template <typename Component>
+        Component &get(ChronosEntity entity)
+        {
+            return pool<Component>().get(entity);
+        }
+
+        template <typename... Components>
+        ChronosView<Components...> view()
+        {
+            return ChronosView<Components...>{&pool<Components>()...};
+        }
+
+        template <typename Component>
+        ChronosComponentPool<Component> &pool()
+        {
+            size_t id = componentTypeId<Component>();
+            if (id >= pools.size()) {
+                pools.resize(id + 1);
+            }
+            if (!pools[id]) {
+                pools[id] = std::make_unique<ChronosComponentPool<Component>>();
+            }
+            return *static_cast<ChronosComponentPool<Component> *>(pools[id].get());
+        }
+
+    private:
+        static size_t nextComponentTypeId()
+        {
+            static size_t nextId = 0;
+            return nextId++;
+        }
+
+        template <typename Component>
+        static size_t componentTypeId()
+        {
+            static const size_t id = nextComponentTypeId();
+            return id;
+        }
+
+        std::vector<uint32_t> generations;
+        std::vector<uint32_t> freeIndices;
+        std::vector<std::unique_ptr<ChronosComponentPoolBase>> pools;
+        size_t aliveCount = 0;
+    };
+}
@@ -0,0 +1,89 @@
+#include "chronos_frame_context.hpp"
+
+//std
+#include <cassert>
+#include <stdexcept>
+
+namespace Chronos {
+
+    ChronosFrameContext::ChronosFrameContext(ChronosDevice &device, uint32_t workerCount)
+        : chronosDevice{device}, workerPools(workerCount)
+    {
+        createPool(primaryPool);
+        for (auto &workerPool : workerPools) {
+            createPool(workerPool);
+        }
+    }
+
+    ChronosFrameContext::~ChronosFrameContext()
+    {
+        // destroying a pool frees every buffer allocated from it
+        vkDestroyCommandPool(chronosDevice.device(), primaryPool.pool, nullptr);
+        for (auto &workerPool : workerPools) {
+            vkDestroyCommandPool(chronosDevice.device(), workerPool.pool, nullptr);
+        }
+    }
+
+    void ChronosFrameContext::reset()
+    {
+        resetPool(primaryPool);
+        for (auto &workerPool : workerPools) {
+            resetPool(workerPool);
+        }
+    }
+
+    VkCommandBuffer ChronosFrameContext::allocatePrimary()
+    {
+        return allocate(primaryPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+    }
+
+    VkCommandBuffer ChronosFrameContext::allocateSecondary(uint32_t workerIndex)
+    {
+        assert(workerIndex < workerPools.size() && "Worker index out of range");
+        return allocate(workerPools[workerIndex], VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+    }
+
+    void ChronosFrameContext::createPool(LinearCommandPool &linearPool)
+    {
+        VkCommandPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.queueFamilyIndex = chronosDevice.findPhysicalQueueFamilies().graphicsFamily;
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+        if (vkCreateCommandPool(chronosDevice.device(), &poolInfo, nullptr, &linearPool.pool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create frame command pool!");
+        }
+    }
+
+    void ChronosFrameContext::resetPool(LinearCommandPool &linearPool)
+    {
+        if (linearPool.usedCount[0] == 0 && linearPool.usedCount[1] == 0) {
+            return;
+        }
+        vkResetCommandPool(chronosDevice.device(), linearPool.pool, 0);
+        linearPool.usedCount[0] = 0;
+        linearPool.usedCount[1] = 0;
+    }
+
+    VkCommandBuffer ChronosFrameContext::allocate(LinearCommandPool &linearPool, VkCommandBufferLevel level)
+    {
+        auto &buffers = linearPool.buffers[level];
+        size_t &usedCount = linearPool.usedCount[level];
+
+        // buffers survive the pool reset, so steady state never allocates
+        if (usedCount == buffers.size()) {
+            VkCommandBufferAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.level = level;
+            allocInfo.commandPool = linearPool.pool;
+            allocInfo.commandBufferCount = 1;
+
+            VkCommandBuffer commandBuffer;
+            if (vkAllocateCommandBuffers(chronosDevice.device(), &allocInfo, &commandBuffer) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to allocate command buffers!");
+            }
+            buffers.push_back(commandBuffer);
+        }
+        return buffers[usedCount++];
+    }
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "chronos_device.hpp"
+
+//std
+#include <cstdint>
+#include <vector>
+
+namespace Chronos {
+
+    // Command recording state for one frame in flight. Every pool is reset in one
+    // call at frame start and buffers are handed out linearly, so recording never
+    // frees individual command buffers or touches the device's upload pool.
+    class ChronosFrameContext {
+    public:
+        ChronosFrameContext(ChronosDevice &device, uint32_t workerCount);
+        ~ChronosFrameContext();
+
+        ChronosFrameContext(const ChronosFrameContext &) = delete;
+        ChronosFrameContext &operator=(const ChronosFrameContext &) = delete;
+
+        // The frame's previous submission must have completed.
+        void reset();
+
+        VkCommandBuffer allocatePrimary();
+        // Each worker index may only be used by one thread at a time.
+        VkCommandBuffer allocateSecondary(uint32_t workerIndex);
+
+    private:
+        struct LinearCommandPool {
+            VkCommandPool pool = VK_NULL_HANDLE;
+            std::vector<VkCommandBuffer> buffers[2]; // indexed by VkCommandBufferLevel
+            size_t usedCount[2] = {0, 0};
+        };
+
+        void createPool(LinearCommandPool &linearPool);
+        void resetPool(LinearCommandPool &linearPool);
+        VkCommandBuffer allocate(LinearCommandPool &linearPool, VkCommandBufferLevel level);
+
+        ChronosDevice &chronosDevice;
+        LinearCommandPool primaryPool;
+        std::vector<LinearCommandPool> workerPools;
+    };
+}
@@ -0,0 +1,474 @@
+#include "chronos_gpu_culling.hpp"
+#include "chronos_instance_buffer.hpp"
+
+//std
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace Chronos {
+
+    ChronosGpuCulling::ChronosGpuCulling(
+            ChronosDevice &device,
+            ChronosShaderLibrary &shaderLibrary,
+            ChronosPipelineLayoutCache &layoutCache,
+            uint32_t framesInFlight,
+            const std::string &cullShaderFilepath)
+        : chronosDevice{device}, layoutCache{layoutCache}, cullShaderFilepath{cullShaderFilepath}, frames(framesInFlight)
+    {
+        createDescriptorPool();
+        pipeline = createPipeline(shaderLibrary);
+
+        std::vector<VkDescriptorSetLayout> layouts(frames.size(), descriptorSetLayout);
+        VkDescriptorSetAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorPool = descriptorPool;
+        allocInfo.descriptorSetCount = static_cast<uint32_t>(layouts.size());
+        allocInfo.pSetLayouts = layouts.data();
+
+        std::vector<VkDescriptorSet> descriptorSets(frames.size());
+        if (vkAllocateDescriptorSets(chronosDevice.device(), &allocInfo, descriptorSets.data()) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate culling descriptor sets!");
+        }
+        for (size_t i = 0; i < frames.size(); i++) {
+            frames[i].descriptorSet = descriptorSets[i];
+        }
+        ensureObjectCapacity(1024);
+        for (auto &frame : frames) {
+            ensureUploadCapacity(frame, 1024);
+            ensureCapacity(frame, 1024, 16);
+        }
+    }
+
+    ChronosGpuCulling::~ChronosGpuCulling()
+    {
+        for (auto &frame : frames) {
+            destroyBuffers(frame);
+            chronosDevice.destroyBuffer(frame.uploadBuffer, frame.uploadAllocation);
+        }
+        chronosDevice.destroyBuffer(objectBuffer, objectAllocation);
+        vkDestroyPipeline(chronosDevice.device(), pipeline, nullptr);
+        vkDestroyDescriptorPool(chronosDevice.device(), descriptorPool, nullptr);
+    }
+
+    void ChronosGpuCulling::record(
+            VkCommandBuffer commandBuffer,
+            size_t frameIndex,
+            const ChronosRenderSnapshot &snapshot,
+            float alpha)
+    {
+        FrameResources &frame = frames[frameIndex];
+
+        // this slot's fence has signaled, so its counters hold a finished frame
+        if (frame.submitted) {
+            stats.objectCount = frame.objectCount;
+            stats.visibleCount = *static_cast<uint32_t *>(frame.statsAllocation.mappedData);
+            stats.culledCount = stats.objectCount - stats.visibleCount;
+        }
+
+        copyRegions.clear();
+        bool firstRecord = snapshot.frameNumber != recordedSnapshot;
+        recordedSnapshot = snapshot.frameNumber;
+        if ((firstRecord && snapshot.structureChanged) || skippedUnreadyModels) {
+            rebuildObjects(frame, snapshot, alpha);
+        } else {
+            updateChangedObjects(frame, snapshot, alpha, firstRecord);
+        }
+
+        frame.objectCount = objectCount;
+        frame.submitted = true;
+        *static_cast<uint32_t *>(frame.statsAllocation.mappedData) = 0;
+        if (objectCount == 0) {
+            return;
+        }
+
+        uint32_t drawCount = static_cast<uint32_t>(drawModels.size());
+        ensureCapacity(frame, objectCount, drawCount);
+
+        auto *drawCommands = static_cast<DrawCommand *>(frame.drawAllocation.mappedData);
+        drawInstanceBases.resize(drawCount);
+        uint32_t instanceBase = 0;
+        for (uint32_t i = 0; i < drawCount; i++) {
+            drawCommands[i].command.indexCount =
+                    drawModels[i]->hasIndices() ? drawModels[i]->getIndexCount() : drawModels[i]->getVertexCount();
+            drawCommands[i].command.instanceCount = 0; // incremented by the cull shader
+            drawCommands[i].command.firstIndex = 0;
+            drawCommands[i].command.vertexOffset = 0;
+            drawCommands[i].command.firstInstance = 0;
+            drawCommands[i].instanceBase = instanceBase;
+            drawInstanceBases[i] = instanceBase;
+            instanceBase += drawInstanceCounts[i];
+        }
+
+        recordObjectCopies(commandBuffer, frame);
+
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+        vkCmdBindDescriptorSets(
+                commandBuffer,
+                VK_PIPELINE_BIND_POINT_COMPUTE,
+                pipelineLayout,
+                0,
+                1,
+                &frame.descriptorSet,
+                0,
+                nullptr);
+        vkCmdPushConstants(
+                commandBuffer,
+                pipelineLayout,
+                VK_SHADER_STAGE_COMPUTE_BIT,
+                0,
+                sizeof(uint32_t),
+                &objectCount);
+        vkCmdDispatch(commandBuffer, (objectCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+
+        // indirect arguments and compacted instances feed the draws; the counter is read back by the host
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask =
+                VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+        vkCmdPipelineBarrier(
+                commandBuffer,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+                0,
+                1, &barrier,
+                0, nullptr,
+                0, nullptr);
+    }
+
+    uint32_t ChronosGpuCulling::draw(VkCommandBuffer commandBuffer, size_t frameIndex)
+    {
+        FrameResources &frame = frames[frameIndex];
+        if (frame.objectCount == 0) {
+            return 0;
+        }
+
+        VkBuffer buffers[] = {frame.instanceBuffer};
+        for (uint32_t i = 0; i < drawModels.size(); i++) {
+            // each model's compacted range starts at instance 0 of its own binding
+            VkDeviceSize offsets[] = {sizeof(ChronosInstanceBuffer::InstanceData) * drawInstanceBases[i]};
+            vkCmdBindVertexBuffers(commandBuffer, ChronosInstanceBuffer::BINDING, 1, buffers, offsets);
+            drawModels[i]->bind(commandBuffer);
+            if (drawModels[i]->hasIndices()) {
+                vkCmdDrawIndexedIndirect(
+                        commandBuffer,
+                        frame.drawBuffer,
+                        i * sizeof(DrawCommand),
+                        1,
+                        sizeof(DrawCommand));
+            } else {
+                vkCmdDrawIndirect(
+                        commandBuffer,
+                        frame.drawBuffer,
+                        i * sizeof(DrawCommand),
+                        1,
+                        sizeof(DrawCommand));
+            }
+        }
+        return static_cast<uint32_t>(drawModels.size());
+    }
+
+    void ChronosGpuCulling::rebuildObjects(FrameResources &frame, const ChronosRenderSnapshot &snapshot, float alpha)
+    {
+        skippedUnreadyModels = false;
+        movingSlots.clear();
+
+        // assign each model a draw slot and every drawable object an object slot
+        drawModels.clear();
+        drawInstanceCounts.clear();
+        drawLookup.clear();
+        slotBySnapshotObject.assign(snapshot.objects.size(), UINT32_MAX);
+        snapshotObjectBySlot.clear();
+        objectCount = 0;
+
+        ensureUploadCapacity(frame, static_cast<uint32_t>(snapshot.objects.size()));
+        auto *objects = static_cast<ObjectData *>(frame.uploadAllocation.mappedData);
+        for (uint32_t i = 0; i < snapshot.objects.size(); i++) {
+            ChronosModel *model = snapshot.objects[i].model.get();
+            // still streaming in; pick it up once the upload lands
+            if (!model->isReady()) {
+                skippedUnreadyModels = true;
+                continue;
+            }
+
+            auto [it, inserted] = drawLookup.try_emplace(model, static_cast<uint32_t>(drawModels.size()));
+            if (inserted) {
+                drawModels.push_back(model);
+                drawInstanceCounts.push_back(0);
+            }
+            drawInstanceCounts[it->second]++;
+
+            slotBySnapshotObject[i] = objectCount;
+            snapshotObjectBySlot.push_back(i);
+            writeObject(objects[objectCount], snapshot.objects[i], alpha);
+            objectCount++;
+        }
+        for (uint32_t object : snapshot.changedObjects) {
+            if (slotBySnapshotObject[object] != UINT32_MAX) {
+                movingSlots.push_back(slotBySnapshotObject[object]);
+            }
+        }
+
+        if (objectCount > 0) {
+            ensureObjectCapacity(objectCount);
+            copyRegions.push_back({0, 0, sizeof(ObjectData) * objectCount});
+        }
+    }
+
+    void ChronosGpuCulling::updateChangedObjects(
+            FrameResources &frame,
+            const ChronosRenderSnapshot &snapshot,
+            float alpha,
+            bool firstRecord)
+    {
+        // the last snapshot's movers were left part-way; the new one holds where they stopped
+        dirtySlots.clear();
+        if (firstRecord) {
+            dirtySlots.swap(movingSlots);
+            movingSlots.clear();
+            for (uint32_t object : snapshot.changedObjects) {
+                if (slotBySnapshotObject[object] != UINT32_MAX) {
+                    movingSlots.push_back(slotBySnapshotObject[object]);
+                }
+            }
+        }
+        dirtySlots.insert(dirtySlots.end(), movingSlots.begin(), movingSlots.end());
+        if (dirtySlots.empty()) {
+            return;
+        }
+
+        // copy regions must not overlap, and sorted slots let neighbours share one region
+        std::sort(dirtySlots.begin(), dirtySlots.end());
+        dirtySlots.erase(std::unique(dirtySlots.begin(), dirtySlots.end()), dirtySlots.end());
+
+        ensureUploadCapacity(frame, static_cast<uint32_t>(dirtySlots.size()));
+        auto *objects = static_cast<ObjectData *>(frame.uploadAllocation.mappedData);
+        for (uint32_t i = 0; i < dirtySlots.size(); i++) {
+            writeObject(objects[i], snapshot.objects[snapshotObjectBySlot[dirtySlots[i]]], alpha);
+
+            VkDeviceSize srcOffset = sizeof(ObjectData) * i;
+            VkDeviceSize dstOffset = sizeof(ObjectData) * dirtySlots[i];
+            if (i > 0 && dirtySlots[i] == dirtySlots[i - 1] + 1) {
+                copyRegions.back().size += sizeof(ObjectData);
+            } else {
+                copyRegions.push_back({srcOffset, dstOffset, sizeof(ObjectData)});
+            }
+        }
+    }
+
+    void ChronosGpuCulling::createDescriptorPool()
+    {
+        VkDescriptorPoolSize poolSize{};
+        poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        poolSize.descriptorCount = static_cast<uint32_t>(4 * frames.size());
+
+        VkDescriptorPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.poolSizeCount = 1;
+        poolInfo.pPoolSizes = &poolSize;
+        poolInfo.maxSets = static_cast<uint32_t>(frames.size());
+
+        if (vkCreateDescriptorPool(chronosDevice.device(), &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create culling descriptor pool!");
+        }
+    }
+
+    std::shared_ptr<void> ChronosGpuCulling::reloadShader(ChronosShaderLibrary &shaderLibrary)
+    {
+        VkPipeline replaced = pipeline;
+        pipeline = createPipeline(shaderLibrary);
+        VkDevice device = chronosDevice.device();
+        return std::shared_ptr<void>(nullptr, [device, replaced](void *) {
+            vkDestroyPipeline(device, replaced, nullptr);
+        });
+    }
+
+    VkPipeline ChronosGpuCulling::createPipeline(ChronosShaderLibrary &shaderLibrary)
+    {
+        auto shaderModule = shaderLibrary.loadModule(cullShaderFilepath);
+        // descriptor sets are allocated and recorded against the first layout
+        VkPipelineLayout reflectedLayout = layoutCache.getLayout({&shaderModule->getReflection()});
+        if (pipelineLayout == VK_NULL_HANDLE) {
+            pipelineLayout = reflectedLayout;
+            // 0: objects, 1: draw commands, 2: visible instances, 3: stats
+            descriptorSetLayout = layoutCache.getSetLayout(pipelineLayout, 0);
+            if (descriptorSetLayout == VK_NULL_HANDLE) {
+                throw std::runtime_error("cull shader declares no descriptor set 0!");
+            }
+        } else if (reflectedLayout != pipelineLayout) {
+            throw std::runtime_error("cull shader layout changed; restart to apply it!");
+        }
+
+        VkComputePipelineCreateInfo pipelineInfo{};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipelineInfo.stage.module = shaderModule->getModule();
+        pipelineInfo.stage.pName = "main";
+        pipelineInfo.layout = pipelineLayout;
+        pipelineInfo.basePipelineIndex = -1;
+        pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+        VkPipeline computePipeline;
+        VkResult result = vkCreateComputePipelines(
+                chronosDevice.device(), chronosDevice.pipelineCache(), 1, &pipelineInfo, nullptr, &computePipeline);
+        if (result != VK_SUCCESS) {
+            throw std::runtime_error("failed to create culling pipeline!");
+        }
+        return computePipeline;
+    }
+
+    void ChronosGpuCulling::writeObject(ObjectData &data, const ChronosRenderObject &object, float alpha)
+    {
+        ChronosModel *model = object.model.get();
+        data.transform = object.interpolatedTransform(alpha);
+        data.offset = object.interpolatedOffset(alpha);
+        data.boundingRadius = model->getBoundingRadius();
+        data.drawIndex = drawLookup[model];
+        data.color = glm::vec4{object.color, 1.f};
+    }
+
+    void ChronosGpuCulling::recordObjectCopies(VkCommandBuffer commandBuffer, FrameResources &frame)
+    {
+        if (copyRegions.empty()) {
+            return;
+        }
+
+        // the previous frame's cull pass may still be reading the slots we overwrite
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        vkCmdPipelineBarrier(
+                commandBuffer,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                VK_PIPELINE_STAGE_TRANSFER_BIT,
+                0,
+                1, &barrier,
+                0, nullptr,
+                0, nullptr);
+
+        vkCmdCopyBuffer(
+                commandBuffer,
+                frame.uploadBuffer,
+                objectBuffer,
+                static_cast<uint32_t>(copyRegions.size()),
+                copyRegions.data());
+
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(
+                commandBuffer,
+                VK_PIPELINE_STAGE_TRANSFER_BIT,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                0,
+                1, &barrier,
+                0, nullptr,
+                0, nullptr);
+    }
+
+    void ChronosGpuCulling::ensureObjectCapacity(uint32_t objectCount)
+    {
+        if (objectCount <= objectCapacity) {
+            return;
+        }
+        // every frame's descriptor set points at the object buffer, so none may be in flight.
+        // Growth only happens on a rebuild, which re-uploads every object anyway.
+        vkDeviceWaitIdle(chronosDevice.device());
+        if (objectBuffer != VK_NULL_HANDLE) {
+            chronosDevice.destroyBuffer(objectBuffer, objectAllocation);
+        }
+        objectCapacity = std::max(objectCount, objectCapacity * 2);
+        chronosDevice.createBuffer(
+                sizeof(ObjectData) * objectCapacity,
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                objectBuffer,
+                objectAllocation);
+        for (auto &frame : frames) {
+            if (frame.drawBuffer != VK_NULL_HANDLE) {
+                writeDescriptorSet(frame);
+            }
+        }
+    }
+
+    void ChronosGpuCulling::ensureUploadCapacity(FrameResources &frame, uint32_t objectCount)
+    {
+        if (objectCount <= frame.uploadCapacity) {
+            return;
+        }
+        if (frame.uploadBuffer != VK_NULL_HANDLE) {
+            chronosDevice.destroyBuffer(frame.uploadBuffer, frame.uploadAllocation);
+        }
+        frame.uploadCapacity = std::max(objectCount, frame.uploadCapacity * 2);
+        chronosDevice.createBuffer(
+                sizeof(ObjectData) * frame.uploadCapacity,
+                VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                frame.uploadBuffer,
+                frame.uploadAllocation);
+    }
+
+    void ChronosGpuCulling::ensureCapacity(FrameResources &frame, uint32_t objectCount, uint32_t drawCount)
+    {
+        if (objectCount <= frame.instanceCapacity && drawCount <= frame.drawCapacity) {
+            return;
+        }
+        destroyBuffers(frame);
+        frame.instanceCapacity = std::max(objectCount, frame.instanceCapacity * 2);
+        frame.drawCapacity = std::max(drawCount, frame.drawCapacity * 2);
+
+        chronosDevice.createBuffer(
+                sizeof(DrawCommand) * frame.drawCapacity,
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                frame.drawBuffer,
+                frame.drawAllocation);
+        chronosDevice.createBuffer(
+                sizeof(ChronosInstanceBuffer::InstanceData) * frame.instanceCapacity,
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                frame.instanceBuffer,
+                frame.instanceAllocation);
+        chronosDevice.createBuffer(
+                sizeof(uint32_t),
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                frame.statsBuffer,
+                frame.statsAllocation);
+        writeDescriptorSet(frame);
+    }
+
+    void ChronosGpuCulling::destroyBuffers(FrameResources &frame)
+    {
+        if (frame.drawBuffer == VK_NULL_HANDLE) {
+            return;
+        }
+        chronosDevice.destroyBuffer(frame.drawBuffer, frame.drawAllocation);
+        chronosDevice.destroyBuffer(frame.instanceBuffer, frame.instanceAllocation);
+        chronosDevice.destroyBuffer(frame.statsBuffer, frame.statsAllocation);
+        frame.drawBuffer = VK_NULL_HANDLE;
+    }
+
+    void ChronosGpuCulling::writeDescriptorSet(FrameResources &frame)
+    {
+        std::array<VkDescriptorBufferInfo, 4> bufferInfos{};
+        bufferInfos[0] = {objectBuffer, 0, VK_WHOLE_SIZE};
+        bufferInfos[1] = {frame.drawBuffer, 0, VK_WHOLE_SIZE};
+        bufferInfos[2] = {frame.instanceBuffer, 0, VK_WHOLE_SIZE};
+        bufferInfos[3] = {frame.statsBuffer, 0, VK_WHOLE_SIZE};
+
+        std::array<VkWriteDescriptorSet, 4> writes{};
+        for (uint32_t i = 0; i < writes.size(); i++) {
+            writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writes[i].dstSet = frame.descriptorSet;
+            writes[i].dstBinding = i;
+            writes[i].descriptorCount = 1;
+            writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            writes[i].pBufferInfo = &bufferInfos[i];
+        }
+        vkUpdateDescriptorSets(
+                chronosDevice.device(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+    }
+}
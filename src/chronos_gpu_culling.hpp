@@ -0,0 +1,174 @@
+#pragma once
+
+#include "chronos_device.hpp"
+#include "chronos_pipeline_layout_cache.hpp"
+#include "chronos_render_snapshot.hpp"
+#include "chronos_shader_library.hpp"
+
+//std
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Chronos {
+
+    // GPU-driven draw path. Object bounds and transforms live in a persistent
+    // device-local SSBO, a compute pass culls them against the clip-space viewport
+    // and compacts the survivors into per-model instance ranges, and each model is
+    // drawn with one vkCmdDrawIndexedIndirect whose instanceCount the compute pass
+    // filled in.
+    //
+    // The object buffer is only rebuilt when the snapshot's structure changed.
+    // Otherwise just the snapshot's changed objects are copied in, so a static
+    // scene costs O(models) per frame. Every published snapshot must be recorded,
+    // in order. A snapshot may be recorded again with a later alpha, which only
+    // re-uploads the objects it moved.
+    //
+    // Only core Vulkan 1.0 is used (one indirect command per call, so neither
+    // multiDrawIndirect nor drawIndirectCount is required). firstInstance is left
+    // at 0 and the instance buffer is bound at each model's range instead, so
+    // drawIndirectFirstInstance is not required either. Models without an index
+    // buffer are drawn with vkCmdDrawIndirect from the same command layout.
+    class ChronosGpuCulling {
+    public:
+        static constexpr uint32_t WORKGROUP_SIZE = 64;
+
+        struct Stats {
+            uint32_t objectCount = 0;
+            uint32_t visibleCount = 0;
+            uint32_t culledCount = 0;
+        };
+
+        ChronosGpuCulling(
+                ChronosDevice &device,
+                ChronosShaderLibrary &shaderLibrary,
+                ChronosPipelineLayoutCache &layoutCache,
+                uint32_t framesInFlight,
+                const std::string &cullShaderFilepath);
+        ~ChronosGpuCulling();
+
+        ChronosGpuCulling(const ChronosGpuCulling &) = delete;
+        ChronosGpuCulling &operator=(const ChronosGpuCulling &) = delete;
+
+        // Uploads changed objects, interpolated by alpha, and records the cull dispatch.
+        // Must be recorded outside the render pass, after the frame's fence has been waited on.
+        void record(
+                VkCommandBuffer commandBuffer,
+                size_t frameIndex,
+                const ChronosRenderSnapshot &snapshot,
+                float alpha);
+        // Records the indirect draws inside the render pass. Expects a pipeline with the
+        // instanced vertex layout to be bound. Returns the number of draw calls.
+        uint32_t draw(VkCommandBuffer commandBuffer, size_t frameIndex);
+
+        // The cull shader's test: the object's bounding circle against the [-1, 1] viewport.
+        static bool isOnScreen(const glm::mat2 &transform, const glm::vec2 &offset, float boundingRadius)
+        {
+            float radius = boundingRadius * std::max(glm::length(transform[0]), glm::length(transform[1]));
+            return std::abs(offset.x) <= 1.f + radius && std::abs(offset.y) <= 1.f + radius;
+        }
+
+        // Counts from the most recent frame the GPU has finished.
+        const Stats &getStats() const { return stats; }
+
+        const std::string &getShaderFilepath() const { return cullShaderFilepath; }
+        // Rebuilds the cull pipeline from the shader's current contents, between
+        // frames. Returns the replaced pipeline, which is destroyed when the returned
+        // handle is released; hold it until frames using it have completed. Throws and
+        // keeps the current pipeline if the build fails or the shader's layout changed.
+        std::shared_ptr<void> reloadShader(ChronosShaderLibrary &shaderLibrary);
+
+    private:
+        // std430 layout shared with cull.comp
+        struct ObjectData {
+            glm::mat2 transform;
+            glm::vec2 offset;
+            float boundingRadius;
+            uint32_t drawIndex;
+            glm::vec4 color;
+        };
+        static_assert(sizeof(ObjectData) == 48, "ObjectData must match the std430 layout in cull.comp");
+
+        // std430 layout shared with cull.comp. A model without indices reads its first
+        // 16 bytes as a VkDrawIndirectCommand: indexCount holds its vertexCount, and
+        // firstIndex and vertexOffset its firstVertex and firstInstance, both 0.
+        struct DrawCommand {
+            VkDrawIndexedIndirectCommand command;
+            uint32_t instanceBase;
+        };
+        static_assert(sizeof(DrawCommand) == 24, "DrawCommand must match the std430 layout in cull.comp");
+
+        struct FrameResources {
+            // host-visible staging for this frame's object updates
+            VkBuffer uploadBuffer = VK_NULL_HANDLE;
+            ChronosAllocation uploadAllocation{};
+            uint32_t uploadCapacity = 0;
+
+            VkBuffer drawBuffer = VK_NULL_HANDLE;
+            ChronosAllocation drawAllocation{};
+            VkBuffer instanceBuffer = VK_NULL_HANDLE;
+            ChronosAllocation instanceAllocation{};
+            VkBuffer statsBuffer = VK_NULL_HANDLE;
+            ChronosAllocation statsAllocation{};
+            uint32_t instanceCapacity = 0;
+            uint32_t drawCapacity = 0;
+            VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+
+            uint32_t objectCount = 0;
+            bool submitted = false;
+        };
+
+        void createDescriptorPool();
+        VkPipeline createPipeline(ChronosShaderLibrary &shaderLibrary);
+        void rebuildObjects(FrameResources &frame, const ChronosRenderSnapshot &snapshot, float alpha);
+        void updateChangedObjects(
+                FrameResources &frame,
+                const ChronosRenderSnapshot &snapshot,
+                float alpha,
+                bool firstRecord);
+        void writeObject(ObjectData &data, const ChronosRenderObject &object, float alpha);
+        void recordObjectCopies(VkCommandBuffer commandBuffer, FrameResources &frame);
+        void ensureObjectCapacity(uint32_t objectCount);
+        void ensureUploadCapacity(FrameResources &frame, uint32_t objectCount);
+        void ensureCapacity(FrameResources &frame, uint32_t objectCount, uint32_t drawCount);
+        void destroyBuffers(FrameResources &frame);
+        void writeDescriptorSet(FrameResources &frame);
+
+        ChronosDevice &chronosDevice;
+        ChronosPipelineLayoutCache &layoutCache;
+        std::string cullShaderFilepath;
+
+        // owned by layoutCache
+        VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+        VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+        VkDescriptorPool descriptorPool;
+        VkPipeline pipeline;
+
+        std::vector<FrameResources> frames;
+        Stats stats{};
+
+        // persistent object buffer and the layout it was built with
+        VkBuffer objectBuffer = VK_NULL_HANDLE;
+        ChronosAllocation objectAllocation{};
+        uint32_t objectCapacity = 0;
+        uint32_t objectCount = 0;
+        std::vector<ChronosModel *> drawModels;
+        std::vector<uint32_t> drawInstanceCounts;
+        // first instance buffer slot of each draw
+        std::vector<uint32_t> drawInstanceBases;
+        std::unordered_map<ChronosModel *, uint32_t> drawLookup;
+        std::vector<uint32_t> slotBySnapshotObject;
+        std::vector<uint32_t> snapshotObjectBySlot;
+        bool skippedUnreadyModels = false;
+        uint64_t recordedSnapshot = 0;
+        // slots uploaded mid-interpolation, settled when the next snapshot arrives
+        std::vector<uint32_t> movingSlots;
+
+        std::vector<uint32_t> dirtySlots;
+        std::vector<VkBufferCopy> copyRegions;
+    };
+}
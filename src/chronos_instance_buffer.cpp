@@ -0,0 +1,89 @@
+#include "chronos_instance_buffer.hpp"
+
+//std
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+
+namespace Chronos {
+
+    ChronosInstanceBuffer::ChronosInstanceBuffer(ChronosDevice &device, uint32_t framesInFlight, uint32_t initialCapacity)
+        : chronosDevice{device}, frameBuffers(framesInFlight)
+    {
+        for (auto &frameBuffer : frameBuffers) {
+            createFrameBuffer(frameBuffer, initialCapacity);
+        }
+    }
+
+    ChronosInstanceBuffer::~ChronosInstanceBuffer()
+    {
+        for (auto &frameBuffer : frameBuffers) {
+            chronosDevice.destroyBuffer(frameBuffer.buffer, frameBuffer.allocation);
+        }
+    }
+
+    ChronosInstanceBuffer::InstanceData *ChronosInstanceBuffer::map(size_t frameIndex, uint32_t instanceCount)
+    {
+        assert(frameIndex < frameBuffers.size() && "Frame index out of range");
+
+        FrameBuffer &frameBuffer = frameBuffers[frameIndex];
+        if (instanceCount > frameBuffer.capacity) {
+            chronosDevice.destroyBuffer(frameBuffer.buffer, frameBuffer.allocation);
+            createFrameBuffer(frameBuffer, std::max(instanceCount, frameBuffer.capacity * 2));
+        }
+        return static_cast<InstanceData *>(frameBuffer.allocation.mappedData);
+    }
+
+    void ChronosInstanceBuffer::bind(VkCommandBuffer commandBuffer, size_t frameIndex)
+    {
+        VkBuffer buffers[] = {frameBuffers[frameIndex].buffer};
+        VkDeviceSize offsets[] = {0};
+        vkCmdBindVertexBuffers(commandBuffer, BINDING, 1, buffers, offsets);
+    }
+
+    void ChronosInstanceBuffer::createFrameBuffer(FrameBuffer &frameBuffer, uint32_t capacity)
+    {
+        frameBuffer.capacity = std::max(capacity, 1u);
+        chronosDevice.createBuffer(
+                sizeof(InstanceData) * frameBuffer.capacity,
+                VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                frameBuffer.buffer,
+                frameBuffer.allocation);
+    }
+
+    std::vector<VkVertexInputBindingDescription> ChronosInstanceBuffer::InstanceData::getBindingDescriptions()
+    {
+        std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
+        bindingDescriptions[0].binding = BINDING;
+        bindingDescriptions[0].stride = sizeof(InstanceData);
+        bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+        return bindingDescriptions;
+    }
+
+    std::vector<VkVertexInputAttributeDescription> ChronosInstanceBuffer::InstanceData::getAttributeDescriptions()
+    {
+        // a mat2 input occupies one location per column
+        std::vector<VkVertexInputAttributeDescription> attributeDescriptions(4);
+        attributeDescriptions[0].binding = BINDING;
+        attributeDescriptions[0].location = 2;
+        attributeDescriptions[0].format = VK_FORMAT_R32G32_SFLOAT;
+        attributeDescriptions[0].offset = offsetof(InstanceData, transform);
+
+        attributeDescriptions[1].binding = BINDING;
+        attributeDescriptions[1].location = 3;
+        attributeDescriptions[1].format = VK_FORMAT_R32G32_SFLOAT;
+        attributeDescriptions[1].offset = offsetof(InstanceData, transform) + sizeof(glm::vec2);
+
+        attributeDescriptions[2].binding = BINDING;
+        attributeDescriptions[2].location = 4;
+        attributeDescriptions[2].format = VK_FORMAT_R32G32_SFLOAT;
+        attributeDescriptions[2].offset = offsetof(InstanceData, offset);
+
+        attributeDescriptions[3].binding = BINDING;
+        attributeDescriptions[3].location = 5;
+        attributeDescriptions[3].format = VK_FORMAT_R32G32B32_SFLOAT;
+        attributeDescriptions[3].offset = offsetof(InstanceData, color);
+        return attributeDescriptions;
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "chronos_device.hpp"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+//std
+#include <cstdint>
+#include <vector>
+
+namespace Chronos {
+
+    // Per-instance attributes streamed on vertex binding 1. One host-visible buffer
+    // per frame in flight, so writing a frame never races the GPU reading the last.
+    class ChronosInstanceBuffer {
+    public:
+        static constexpr uint32_t BINDING = 1;
+
+        struct InstanceData {
+            glm::mat2 transform{1.f};
+            glm::vec2 offset{};
+            glm::vec3 color{};
+
+            static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
+            static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
+        };
+
+        ChronosInstanceBuffer(ChronosDevice &device, uint32_t framesInFlight, uint32_t initialCapacity = 1024);
+        ~ChronosInstanceBuffer();
+
+        ChronosInstanceBuffer(const ChronosInstanceBuffer &) = delete;
+        ChronosInstanceBuffer &operator=(const ChronosInstanceBuffer &) = delete;
+
+        // Returns room for instanceCount instances in frameIndex's buffer, growing it if
+        // needed. The frame's previous submission must have completed.
+        InstanceData *map(size_t frameIndex, uint32_t instanceCount);
+        void bind(VkCommandBuffer commandBuffer, size_t frameIndex);
+
+    private:
+        struct FrameBuffer {
+            VkBuffer buffer = VK_NULL_HANDLE;
+            ChronosAllocation allocation{};
+            uint32_t capacity = 0;
+        };
+
+        void createFrameBuffer(FrameBuffer &frameBuffer, uint32_t capacity);
+
+        ChronosDevice &chronosDevice;
+        std::vector<FrameBuffer> frameBuffers;
+    };
+}
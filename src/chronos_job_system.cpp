@@ -0,0 +1,210 @@
+#include "chronos_job_system.hpp"
+
+//std
+#include <algorithm>
+#include <cassert>
+
+namespace Chronos {
+
+    namespace {
+        // which system and deque the current thread last worked from; set for good in a
+        // pool worker, and on first use in any other thread
+        thread_local const ChronosJobSystem *currentSystem = nullptr;
+        thread_local uint32_t currentQueue = 0;
+    }
+
+    uint32_t ChronosJobSystem::defaultWorkerCount()
+    {
+        uint32_t hardwareThreads = std::thread::hardware_concurrency();
+        return hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+    }
+
+    ChronosJobSystem::ChronosJobSystem(uint32_t workerCount)
+    {
+        queues.reserve(EXTERNAL_QUEUES + workerCount);
+        for (uint32_t i = 0; i < EXTERNAL_QUEUES + workerCount; i++) {
+            queues.push_back(std::make_unique<WorkQueue>());
+        }
+        workers.reserve(workerCount);
+        for (uint32_t i = 0; i < workerCount; i++) {
+            workers.emplace_back(&ChronosJobSystem::workerLoop, this, EXTERNAL_QUEUES + i);
+        }
+    }
+
+    ChronosJobSystem::~ChronosJobSystem()
+    {
+        {
+            std::lock_guard<std::mutex> lock{sleepMutex};
+            stopping = true;
+        }
+        wakeCondition.notify_all();
+        for (auto &worker : workers) {
+            worker.join();
+        }
+        assert(queuedJobs == 0 && "Job system destroyed with jobs still queued");
+    }
+
+    void ChronosJobSystem::run(JobFunction job, ChronosJobCounter *counter)
+    {
+        if (counter) {
+            counter->pending.fetch_add(1, std::memory_order_relaxed);
+        }
+        push({std::move(job), counter});
+    }
+
+    void ChronosJobSystem::runAfter(ChronosJobCounter &dependency, JobFunction job, ChronosJobCounter *counter)
+    {
+        if (counter) {
+            counter->pending.fetch_add(1, std::memory_order_relaxed);
+        }
+        {
+            std::lock_guard<std::mutex> lock{dependency.mutex};
+            if (!dependency.isDone()) {
+                dependency.continuations.push_back({std::move(job), counter});
+                return;
+            }
+        }
+        push({std::move(job), counter});
+    }
+
+    void ChronosJobSystem::wait(ChronosJobCounter &counter)
+    {
+        uint32_t queueIndex = currentQueueIndex();
+        while (!counter.isDone()) {
+            if (!tryRunJob(queueIndex)) {
+                std::this_thread::yield();
+            }
+        }
+        // the finishing thread may still hold the lock it decremented under
+        std::lock_guard<std::mutex> lock{counter.mutex};
+    }
+
+    void ChronosJobSystem::parallelFor(size_t begin, size_t end, size_t grainSize, const RangeFunction &body)
+    {
+        assert(grainSize > 0 && "Grain size must be positive");
+        if (end <= begin) {
+            return;
+        }
+        if (end - begin <= grainSize || workers.empty()) {
+            body(begin, end);
+            return;
+        }
+
+        ChronosJobCounter counter;
+        size_t chunkBegin = begin;
+        for (; end - chunkBegin > grainSize; chunkBegin += grainSize) {
+            size_t chunkEnd = chunkBegin + grainSize;
+            run([&body, chunkBegin, chunkEnd]() { body(chunkBegin, chunkEnd); }, &counter);
+        }
+        body(chunkBegin, end);
+        wait(counter);
+    }
+
+    void ChronosJobSystem::workerLoop(uint32_t queueIndex)
+    {
+        currentSystem = this;
+        currentQueue = queueIndex;
+
+        while (true) {
+            if (tryRunJob(queueIndex)) {
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock{sleepMutex};
+            sleepingWorkers.fetch_add(1);
+            wakeCondition.wait(lock, [this]() { return stopping || queuedJobs.load() > 0; });
+            sleepingWorkers.fetch_sub(1);
+            if (stopping) {
+                return;
+            }
+        }
+    }
+
+    uint32_t ChronosJobSystem::currentQueueIndex()
+    {
+        if (currentSystem != this) {
+            // a thread outside the pool, or a worker of another system, on first use
+            currentSystem = this;
+            currentQueue = nextExternalQueue.fetch_add(1, std::memory_order_relaxed) % EXTERNAL_QUEUES;
+        }
+        return currentQueue;
+    }
+
+    void ChronosJobSystem::push(Job job)
+    {
+        WorkQueue &queue = *queues[currentQueueIndex()];
+        {
+            std::lock_guard<std::mutex> lock{queue.mutex};
+            queue.jobs.push_back(std::move(job));
+        }
+        queuedJobs.fetch_add(1);
+
+        // a worker that saw no jobs either sleeps already or will see this one when it checks
+        if (sleepingWorkers.load() > 0) {
+            { std::lock_guard<std::mutex> lock{sleepMutex}; }
+            wakeCondition.notify_one();
+        }
+    }
+
+    bool ChronosJobSystem::tryRunJob(uint32_t queueIndex)
+    {
+        Job job;
+        if (!popOrSteal(queueIndex, job)) {
+            return false;
+        }
+        job.function();
+        finish(job.counter);
+        return true;
+    }
+
+    bool ChronosJobSystem::popOrSteal(uint32_t queueIndex, Job &job)
+    {
+        if (queuedJobs.load(std::memory_order_relaxed) == 0) {
+            return false;
+        }
+
+        // newest first from our own deque keeps its data hot in cache
+        {
+            WorkQueue &own = *queues[queueIndex];
+            std::lock_guard<std::mutex> lock{own.mutex};
+            if (!own.jobs.empty()) {
+                job = std::move(own.jobs.back());
+                own.jobs.pop_back();
+                queuedJobs.fetch_sub(1);
+                return true;
+            }
+        }
+
+        // oldest first from a victim's, which tends to be the biggest piece of work left
+        for (size_t i = 1; i < queues.size(); i++) {
+            WorkQueue &victim = *queues[(queueIndex + i) % queues.size()];
+            std::unique_lock<std::mutex> lock{victim.mutex, std::try_to_lock};
+            if (!lock.owns_lock() || victim.jobs.empty()) {
+                continue;
+            }
+            job = std::move(victim.jobs.front());
+            victim.jobs.pop_front();
+            queuedJobs.fetch_sub(1);
+            return true;
+        }
+        return false;
+    }
+
+    void ChronosJobSystem::finish(ChronosJobCounter *counter)
+    {
+        if (!counter) {
+            return;
+        }
+
+        std::vector<ChronosJobCounter::Continuation> ready;
+        {
+            std::lock_guard<std::mutex> lock{counter->mutex};
+            if (counter->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                ready.swap(counter->continuations);
+            }
+        }
+        for (auto &continuation : ready) {
+            push({std::move(continuation.function), continuation.counter});
+        }
+    }
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+//std
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Chronos {
+
+    class ChronosJobSystem;
+
+    // Number of unfinished jobs attached to it. Jobs queued with runAfter() start
+    // once it drops to zero. Only destroy a counter after ChronosJobSystem::wait()
+    // on it has returned.
+    class ChronosJobCounter {
+    public:
+        ChronosJobCounter() = default;
+
+        ChronosJobCounter(const ChronosJobCounter &) = delete;
+        ChronosJobCounter &operator=(const ChronosJobCounter &) = delete;
+
+        bool isDone() const { return pending.load(std::memory_order_acquire) == 0; }
+
+    private:
+        friend class ChronosJobSystem;
+
+        struct Continuation {
+            std::function<void()> function;
+            ChronosJobCounter *counter;
+        };
+
+        std::atomic<uint32_t> pending{0};
+        std::mutex mutex;
+        std::vector<Continuation> continuations;
+    };
+
+    // Work-stealing scheduler. Each worker thread owns a deque: it pushes and pops
+    // at the back, and idle workers steal the oldest job from the front of another
+    // worker's deque. Threads outside the pool (the render and simulation threads)
+    // each take one of EXTERNAL_QUEUES deques on first use and run jobs themselves
+    // while they wait, so a pool of N workers keeps N + 1 threads busy.
+    //
+    // A waiting thread runs its own jobs first but steals any other job once its
+    // deque is empty. Two outside threads can therefore run each other's jobs, and a
+    // wait can last as long as the longest job it picked up.
+    class ChronosJobSystem {
+    public:
+        using JobFunction = std::function<void()>;
+        using RangeFunction = std::function<void(size_t begin, size_t end)>;
+
+        // deques for threads outside the pool; beyond this many they share
+        static constexpr uint32_t EXTERNAL_QUEUES = 4;
+
+        // one worker per hardware thread besides the caller
+        static uint32_t defaultWorkerCount();
+
+        explicit ChronosJobSystem(uint32_t workerCount = defaultWorkerCount());
+        ~ChronosJobSystem();
+
+        ChronosJobSystem(const ChronosJobSystem &) = delete;
+        ChronosJobSystem &operator=(const ChronosJobSystem &) = delete;
+
+        // workers plus the participating caller
+        uint32_t getThreadCount() const { return static_cast<uint32_t>(workers.size()) + 1; }
+
+        // Queues job on the calling thread's deque. counter, if given, is incremented
+        // now and decremented when the job finishes.
+        void run(JobFunction job, ChronosJobCounter *counter = nullptr);
+        // Queues job once dependency reaches zero.
+        void runAfter(ChronosJobCounter &dependency, JobFunction job, ChronosJobCounter *counter = nullptr);
+        // Runs queued jobs until counter reaches zero, yielding while there are none.
+        // Safe to call from inside a job.
+        void wait(ChronosJobCounter &counter);
+
+        // Calls body over [begin, end) in chunks of at most grainSize and returns when
+        // all are done. The caller runs one chunk itself. A range of one chunk, or any
+        // range on a pool without workers, is run inline in a single call.
+        void parallelFor(size_t begin, size_t end, size_t grainSize, const RangeFunction &body);
+
+    private:
+        struct Job {
+            JobFunction function;
+            ChronosJobCounter *counter;
+        };
+
+        struct WorkQueue {
+            std::mutex mutex;
+            std::deque<Job> jobs;
+        };
+
+        void workerLoop(uint32_t queueIndex);
+        uint32_t currentQueueIndex();
+        void push(Job job);
+        bool tryRunJob(uint32_t queueIndex);
+        bool popOrSteal(uint32_t queueIndex, Job &job);
+        void finish(ChronosJobCounter *counter);
+
+        // the first EXTERNAL_QUEUES are handed to threads outside the pool, then one per worker
+        std::vector<std::unique_ptr<WorkQueue>> queues;
+        std::vector<std::thread> workers;
+        std::atomic<uint32_t> nextExternalQueue{0};
+
+        std::atomic<uint32_t> queuedJobs{0};
+        std::atomic<uint32_t> sleepingWorkers{0};
+        std::atomic<bool> stopping{false};
+        std::mutex sleepMutex;
+        std::condition_variable wakeCondition;
+    };
+}
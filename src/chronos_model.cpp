@@ -1,54 +1,170 @@
 #include "chronos_model.hpp"
+#include "chronos_staging_ring.hpp"
+#include "chronos_utils.hpp"
 #include <vulkan/vulkan_core.h>
 
+//std
+#include <algorithm>
 #include <cassert>
 #include <cstring>
+#include <exception>
+#include <limits>
+#include <unordered_map>
+
+namespace std {
+    template <>
+    struct hash<Chronos::ChronosModel::Vertex> {
+        size_t operator()(Chronos::ChronosModel::Vertex const &vertex) const
+        {
+            size_t seed = 0;
+            Chronos::hashCombine(
+                    seed,
+                    vertex.position.x,
+                    vertex.position.y,
+                    vertex.color.x,
+                    vertex.color.y,
+                    vertex.color.z);
+            return seed;
+        }
+    };
+}
 
 namespace Chronos {
 
-    ChronosModel::ChronosModel(ChronosDevice &device, const std::vector<Vertex> &vertices)
-        : chronosDevice{device}
+    ChronosModel::ChronosModel(ChronosDevice &device, const Builder &builder)
+        : chronosDevice{device}, hostVisible{builder.hostVisible}
     {
-        createVertexBuffers(vertices);
+        createVertexBuffers(builder.vertices);
+        createIndexBuffers(builder.indices);
     }
 
     ChronosModel::~ChronosModel()
     {
-        vkDestroyBuffer(chronosDevice.device(), vertexBuffer, nullptr);
-        vkFreeMemory(chronosDevice.device(), vertexBufferMemory, nullptr);
-
+        chronosDevice.destroyBuffer(vertexBuffer, vertexBufferAllocation);
+        if (hasIndexBuffer) {
+            chronosDevice.destroyBuffer(indexBuffer, indexBufferAllocation);
+        }
     }
 
 
+    std::vector<std::shared_ptr<ChronosModel>> ChronosModel::createModels(
+            ChronosDevice &device,
+            ChronosJobSystem &jobSystem,
+            const std::vector<std::function<Builder()>> &loaders)
+    {
+        std::vector<Builder> builders(loaders.size());
+        std::vector<std::exception_ptr> errors(loaders.size());
+        jobSystem.parallelFor(0, loaders.size(), 1, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                try {
+                    builders[i] = loaders[i]();
+                } catch (...) {
+                    errors[i] = std::current_exception();
+                }
+            }
+        });
+        for (const auto &error : errors) {
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+
+        std::vector<std::shared_ptr<ChronosModel>> models;
+        models.reserve(builders.size());
+        for (const auto &builder : builders) {
+            models.push_back(std::make_shared<ChronosModel>(device, builder));
+        }
+        return models;
+    }
+
     void ChronosModel::createVertexBuffers(const std::vector<Vertex> &vertices)
     {
         vertexCount = static_cast<uint32_t>(vertices.size());
         assert(vertexCount >= 3 && "Vertex must be at least 3");
+        for (const auto &vertex : vertices) {
+            boundingRadius = std::max(boundingRadius, glm::length(vertex.position));
+        }
         VkDeviceSize bufferSize = sizeof(vertices[0]) * vertexCount;
+        createBuffer(
+                bufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, vertices.data(), vertexBuffer, vertexBufferAllocation);
+    }
+
+    void ChronosModel::createIndexBuffers(const std::vector<uint32_t> &indices)
+    {
+        indexCount = static_cast<uint32_t>(indices.size());
+        hasIndexBuffer = indexCount > 0;
+        if (!hasIndexBuffer) {
+            return;
+        }
+
+        // 16-bit indices halve index bandwidth whenever every vertex is addressable
+        VkDeviceSize bufferSize;
+        std::vector<uint16_t> shortIndices;
+        const void *indexData = indices.data();
+        if (vertexCount <= std::numeric_limits<uint16_t>::max()) {
+            indexType = VK_INDEX_TYPE_UINT16;
+            shortIndices.assign(indices.begin(), indices.end());
+            indexData = shortIndices.data();
+            bufferSize = sizeof(uint16_t) * indexCount;
+        } else {
+            indexType = VK_INDEX_TYPE_UINT32;
+            bufferSize = sizeof(uint32_t) * indexCount;
+        }
+
+        createBuffer(bufferSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, indexData, indexBuffer, indexBufferAllocation);
+    }
+
+    void ChronosModel::createBuffer(
+            VkDeviceSize size,
+            VkBufferUsageFlags usage,
+            const void *data,
+            VkBuffer &buffer,
+            ChronosAllocation &allocation)
+    {
+        if (hostVisible) {
+            chronosDevice.createBuffer(
+                    size,
+                    usage,
+                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                    buffer,
+                    allocation);
+            std::memcpy(allocation.mappedData, data, static_cast<size_t>(size));
+            return;
+        }
+
         chronosDevice.createBuffer(
-                bufferSize,
-                VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                vertexBuffer,
-                vertexBufferMemory);
-
-        void *data;
-        vkMapMemory(chronosDevice.device(), vertexBufferMemory, 0, bufferSize, 0, &data);
-        memcpy(data, vertices.data(), static_cast<size_t>(bufferSize));
-        vkUnmapMemory(chronosDevice.device(), vertexBufferMemory);
+                size,
+                usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                buffer,
+                allocation);
+        // batched with every other pending upload; submitted on the next flush
+        uploadTicket = chronosDevice.stagingRing().uploadBuffer(buffer, 0, data, size);
     }
-    
-    void ChronosModel::draw(VkCommandBuffer commandBuffer)
+
+    bool ChronosModel::isReady() const
     {
-        vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0);
+        return chronosDevice.stagingRing().isReadyForGraphics(uploadTicket);
+    }
 
+    void ChronosModel::draw(VkCommandBuffer commandBuffer, uint32_t instanceCount, uint32_t firstInstance)
+    {
+        if (hasIndexBuffer) {
+            vkCmdDrawIndexed(commandBuffer, indexCount, instanceCount, 0, 0, firstInstance);
+        } else {
+            vkCmdDraw(commandBuffer, vertexCount, instanceCount, 0, firstInstance);
+        }
     }
-    
+
     void ChronosModel::bind(VkCommandBuffer commandBuffer)
     {
         VkBuffer buffers[] = {vertexBuffer};
         VkDeviceSize offsets[] = {0};
         vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
+
+        if (hasIndexBuffer) {
+            vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, indexType);
+        }
     }
 
     std::vector<VkVertexInputBindingDescription> ChronosModel::Vertex::getBindingDescriptions()
@@ -74,4 +190,20 @@ namespace Chronos {
         attributeDescriptions[1].offset = offsetof(Vertex, color);
         return attributeDescriptions;
     }
+
+    void ChronosModel::Builder::loadVertices(const std::vector<Vertex> &triangleList)
+    {
+        vertices.clear();
+        indices.clear();
+        indices.reserve(triangleList.size());
+
+        std::unordered_map<Vertex, uint32_t> uniqueVertices{};
+        for (const auto &vertex : triangleList) {
+            auto [it, inserted] = uniqueVertices.try_emplace(vertex, static_cast<uint32_t>(vertices.size()));
+            if (inserted) {
+                vertices.push_back(vertex);
+            }
+            indices.push_back(it->second);
+        }
+    }
 }
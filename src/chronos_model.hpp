@@ -1,12 +1,15 @@
 #pragma once
 
 #include "chronos_device.hpp"
+#include "chronos_job_system.hpp"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 
 //std
+#include <functional>
+#include <memory>
 #include <vector>
 
 namespace Chronos {
@@ -19,24 +22,77 @@ namespace Chronos {
 
             static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
             static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
+
+            bool operator==(const Vertex &other) const
+            {
+                return position == other.position && color == other.color;
+            }
+        };
+
+        struct Builder
+        {
+            std::vector<Vertex> vertices{};
+            std::vector<uint32_t> indices{};
+            // Draw straight from host-visible memory instead of staging into device-local
+            // memory. The pre-staging path, kept for comparison.
+            bool hostVisible = false;
+
+            // Takes a de-indexed triangle list and collapses identical vertices into
+            // a unique vertex list plus indices.
+            void loadVertices(const std::vector<Vertex> &triangleList);
         };
 
-        ChronosModel(ChronosDevice &device, const std::vector<Vertex> &vertices);
+        ChronosModel(ChronosDevice &device, const Builder &builder);
         ~ChronosModel();
 
+        // Runs each loader as a job, then creates the models in order on the calling
+        // thread, which owns the device's staging ring. Rethrows the first loader's
+        // exception once every job has finished.
+        static std::vector<std::shared_ptr<ChronosModel>> createModels(
+                ChronosDevice &device,
+                ChronosJobSystem &jobSystem,
+                const std::vector<std::function<Builder()>> &loaders);
+
         ChronosModel(const ChronosModel &) = delete;
         ChronosModel &operator=(const ChronosModel &) = delete;
 
         void bind(VkCommandBuffer commandBuffer);
-        void draw(VkCommandBuffer commandBuffer);
+        void draw(VkCommandBuffer commandBuffer, uint32_t instanceCount = 1, uint32_t firstInstance = 0);
+
+        // false until the staged vertex/index data is visible to graphics work
+        bool isReady() const;
+
+        bool hasIndices() const { return hasIndexBuffer; }
+        uint32_t getIndexCount() const { return indexCount; }
+        uint32_t getVertexCount() const { return vertexCount; }
+        // radius of the model-space bounding circle centred on the origin
+        float getBoundingRadius() const { return boundingRadius; }
 
     private:
         void createVertexBuffers(const std::vector<Vertex> &vertices);
+        void createIndexBuffers(const std::vector<uint32_t> &indices);
+        void createBuffer(
+                VkDeviceSize size,
+                VkBufferUsageFlags usage,
+                const void *data,
+                VkBuffer &buffer,
+                ChronosAllocation &allocation);
 
     private:
         ChronosDevice& chronosDevice;
+        bool hostVisible;
+
         VkBuffer vertexBuffer;
-        VkDeviceMemory vertexBufferMemory;
+        ChronosAllocation vertexBufferAllocation;
         uint32_t vertexCount;
+        float boundingRadius = 0.f;
+
+        bool hasIndexBuffer = false;
+        VkBuffer indexBuffer;
+        ChronosAllocation indexBufferAllocation;
+        uint32_t indexCount;
+        VkIndexType indexType;
+
+        uint64_t uploadTicket = 0;
     };
 }
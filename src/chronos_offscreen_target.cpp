@@ -0,0 +1,277 @@
+#include "chronos_offscreen_target.hpp"
+#include "chronos_swap_chain.hpp"
+
+//std
+#include <array>
+#include <cassert>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace Chronos {
+
+    ChronosOffscreenTarget::ChronosOffscreenTarget(
+            ChronosDevice &device,
+            VkExtent2D extent,
+            uint32_t framesInFlight,
+            VkFormat colorFormat)
+        : device{device}, extent{extent}, colorFormat{colorFormat}, frames(framesInFlight)
+    {
+        assert(framesInFlight >= 1 && framesInFlight <= ChronosSwapChain::MAX_FRAMES_IN_FLIGHT &&
+               "Frames in flight out of range");
+        depthFormat = device.findSupportedFormat(
+                {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT},
+                VK_IMAGE_TILING_OPTIMAL,
+                VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+
+        createRenderPass();
+        for (auto &frame : frames) {
+            createFrame(frame);
+        }
+    }
+
+    ChronosOffscreenTarget::~ChronosOffscreenTarget()
+    {
+        for (auto &frame : frames) {
+            vkDestroyFence(device.device(), frame.inFlightFence, nullptr);
+            vkDestroyFramebuffer(device.device(), frame.framebuffer, nullptr);
+            vkDestroyImageView(device.device(), frame.depthView, nullptr);
+            device.destroyImage(frame.depthImage, frame.depthAllocation);
+            vkDestroyImageView(device.device(), frame.colorView, nullptr);
+            device.destroyImage(frame.colorImage, frame.colorAllocation);
+        }
+        if (readbackBuffer != VK_NULL_HANDLE) {
+            device.destroyBuffer(readbackBuffer, readbackAllocation);
+        }
+        vkDestroyRenderPass(device.device(), renderPass, nullptr);
+    }
+
+    void ChronosOffscreenTarget::waitForFrame(size_t frameIndex)
+    {
+        vkWaitForFences(
+                device.device(), 1, &frames[frameIndex].inFlightFence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+    }
+
+    VkResult ChronosOffscreenTarget::acquireNextImage(uint32_t *imageIndex)
+    {
+        waitForFrame(currentFrame);
+        *imageIndex = static_cast<uint32_t>(currentFrame);
+        return VK_SUCCESS;
+    }
+
+    VkResult ChronosOffscreenTarget::submitCommandBuffers(const VkCommandBuffer *buffers, uint32_t *imageIndex)
+    {
+        assert(*imageIndex == currentFrame && "Offscreen frames must be submitted in acquire order");
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = buffers;
+
+        VkFence fence = frames[currentFrame].inFlightFence;
+        vkResetFences(device.device(), 1, &fence);
+        if (vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo, fence) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit offscreen command buffer!");
+        }
+
+        submittedFrames++;
+        currentFrame = (currentFrame + 1) % frames.size();
+        return VK_SUCCESS;
+    }
+
+    std::vector<uint8_t> ChronosOffscreenTarget::readLastFrame()
+    {
+        if (submittedFrames == 0) {
+            return {};
+        }
+
+        const Frame &frame = frames[getPreviousFrame()];
+        VkDeviceSize size = static_cast<VkDeviceSize>(extent.width) * extent.height * 4;
+        if (size > readbackCapacity) {
+            if (readbackBuffer != VK_NULL_HANDLE) {
+                device.destroyBuffer(readbackBuffer, readbackAllocation);
+            }
+            device.createBuffer(
+                    size,
+                    VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                    readbackBuffer,
+                    readbackAllocation);
+            readbackCapacity = size;
+        }
+
+        // queue order puts this after the frame; the barrier makes its color writes visible
+        VkCommandBuffer commandBuffer = device.beginSingleTimeCommands();
+
+        VkMemoryBarrier toTransfer{};
+        toTransfer.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        toTransfer.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        toTransfer.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        vkCmdPipelineBarrier(
+                commandBuffer,
+                VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                VK_PIPELINE_STAGE_TRANSFER_BIT,
+                0,
+                1, &toTransfer,
+                0, nullptr,
+                0, nullptr);
+
+        VkBufferImageCopy region{};
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.layerCount = 1;
+        region.imageExtent = {extent.width, extent.height, 1};
+        vkCmdCopyImageToBuffer(
+                commandBuffer, frame.colorImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readbackBuffer, 1, &region);
+
+        VkMemoryBarrier toHost{};
+        toHost.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        toHost.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        toHost.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+        vkCmdPipelineBarrier(
+                commandBuffer,
+                VK_PIPELINE_STAGE_TRANSFER_BIT,
+                VK_PIPELINE_STAGE_HOST_BIT,
+                0,
+                1, &toHost,
+                0, nullptr,
+                0, nullptr);
+
+        device.endSingleTimeCommands(commandBuffer);
+
+        std::vector<uint8_t> pixels(static_cast<size_t>(size));
+        memcpy(pixels.data(), readbackAllocation.mappedData, pixels.size());
+        return pixels;
+    }
+
+    void ChronosOffscreenTarget::createRenderPass()
+    {
+        // matches ChronosSwapChain::createRenderPass apart from the color final layout,
+        // which keeps pipelines compatible between the two
+        VkAttachmentDescription colorAttachment{};
+        colorAttachment.format = colorFormat;
+        colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        colorAttachment.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+        VkAttachmentDescription depthAttachment{};
+        depthAttachment.format = depthFormat;
+        depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+        VkAttachmentReference colorAttachmentRef{0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+        VkAttachmentReference depthAttachmentRef{1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
+
+        VkSubpassDescription subpass{};
+        subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpass.colorAttachmentCount = 1;
+        subpass.pColorAttachments = &colorAttachmentRef;
+        subpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+        VkSubpassDependency dependency{};
+        dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+        dependency.srcAccessMask = 0;
+        dependency.srcStageMask =
+                VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+        dependency.dstSubpass = 0;
+        dependency.dstStageMask =
+                VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+        dependency.dstAccessMask =
+                VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+        std::array<VkAttachmentDescription, 2> attachments = {colorAttachment, depthAttachment};
+        VkRenderPassCreateInfo renderPassInfo{};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+        renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+        renderPassInfo.pAttachments = attachments.data();
+        renderPassInfo.subpassCount = 1;
+        renderPassInfo.pSubpasses = &subpass;
+        renderPassInfo.dependencyCount = 1;
+        renderPassInfo.pDependencies = &dependency;
+
+        if (vkCreateRenderPass(device.device(), &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create offscreen render pass!");
+        }
+    }
+
+    void ChronosOffscreenTarget::createFrame(Frame &frame)
+    {
+        createImage(
+                colorFormat,
+                VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                VK_IMAGE_ASPECT_COLOR_BIT,
+                frame.colorImage,
+                frame.colorAllocation,
+                frame.colorView);
+        createImage(
+                depthFormat,
+                VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+                VK_IMAGE_ASPECT_DEPTH_BIT,
+                frame.depthImage,
+                frame.depthAllocation,
+                frame.depthView);
+
+        std::array<VkImageView, 2> attachments = {frame.colorView, frame.depthView};
+        VkFramebufferCreateInfo framebufferInfo{};
+        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        framebufferInfo.renderPass = renderPass;
+        framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+        framebufferInfo.pAttachments = attachments.data();
+        framebufferInfo.width = extent.width;
+        framebufferInfo.height = extent.height;
+        framebufferInfo.layers = 1;
+        if (vkCreateFramebuffer(device.device(), &framebufferInfo, nullptr, &frame.framebuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create offscreen framebuffer!");
+        }
+
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+        if (vkCreateFence(device.device(), &fenceInfo, nullptr, &frame.inFlightFence) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create offscreen frame fence!");
+        }
+    }
+
+    void ChronosOffscreenTarget::createImage(
+            VkFormat format,
+            VkImageUsageFlags usage,
+            VkImageAspectFlags aspect,
+            VkImage &image,
+            ChronosAllocation &allocation,
+            VkImageView &view)
+    {
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.extent = {extent.width, extent.height, 1};
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.format = format;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageInfo.usage = usage;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        device.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, allocation);
+
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = format;
+        viewInfo.subresourceRange.aspectMask = aspect;
+        viewInfo.subresourceRange.levelCount = 1;
+        viewInfo.subresourceRange.layerCount = 1;
+        if (vkCreateImageView(device.device(), &viewInfo, nullptr, &view) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create offscreen image view!");
+        }
+    }
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "chronos_device.hpp"
+#include "chronos_render_target.hpp"
+
+//std
+#include <cstdint>
+#include <vector>
+
+namespace Chronos {
+
+    // Headless stand-in for the swap chain: one color and depth image per frame in
+    // flight, left in TRANSFER_SRC layout so the latest frame can be read back. The
+    // default color format is the one ChronosSwapChain prefers, so headless frames
+    // are encoded like windowed ones. The render pass is only compatible with the
+    // swap chain's when the surface offers that format too.
+    class ChronosOffscreenTarget : public ChronosRenderTarget {
+    public:
+        static constexpr VkFormat DEFAULT_FORMAT = VK_FORMAT_B8G8R8A8_SRGB;
+
+        ChronosOffscreenTarget(
+                ChronosDevice &device,
+                VkExtent2D extent,
+                uint32_t framesInFlight,
+                VkFormat colorFormat = DEFAULT_FORMAT);
+        ~ChronosOffscreenTarget() override;
+
+        ChronosOffscreenTarget(const ChronosOffscreenTarget &) = delete;
+        ChronosOffscreenTarget &operator=(const ChronosOffscreenTarget &) = delete;
+
+        VkRenderPass getRenderPass() override { return renderPass; }
+        VkFramebuffer getFrameBuffer(int index) override { return frames[index].framebuffer; }
+        VkExtent2D getExtent() override { return extent; }
+        uint32_t getFramesInFlight() override { return static_cast<uint32_t>(frames.size()); }
+        size_t getCurrentFrame() override { return currentFrame; }
+        size_t getPreviousFrame() override { return (currentFrame + frames.size() - 1) % frames.size(); }
+        VkFormat getImageFormat() const { return colorFormat; }
+
+        void waitForFrame(size_t frameIndex) override;
+        // the image index is always the frame slot; nothing here ever goes out of date
+        VkResult acquireNextImage(uint32_t *imageIndex) override;
+        VkResult submitCommandBuffers(const VkCommandBuffer *buffers, uint32_t *imageIndex) override;
+
+        // Waits for the most recently submitted frame and copies its color image out
+        // as tightly packed rows of 4-byte texels in the image's format. Empty before
+        // the first submission.
+        std::vector<uint8_t> readLastFrame();
+
+    private:
+        struct Frame {
+            VkImage colorImage = VK_NULL_HANDLE;
+            ChronosAllocation colorAllocation{};
+            VkImageView colorView = VK_NULL_HANDLE;
+            VkImage depthImage = VK_NULL_HANDLE;
+            ChronosAllocation depthAllocation{};
+            VkImageView depthView = VK_NULL_HANDLE;
+            VkFramebuffer framebuffer = VK_NULL_HANDLE;
+            VkFence inFlightFence = VK_NULL_HANDLE;
+        };
+
+        void createRenderPass();
+        void createFrame(Frame &frame);
+        void createImage(
+                VkFormat format,
+                VkImageUsageFlags usage,
+                VkImageAspectFlags aspect,
+                VkImage &image,
+                ChronosAllocation &allocation,
+                VkImageView &view);
+
+        ChronosDevice &device;
+        VkExtent2D extent;
+        VkFormat colorFormat;
+        VkFormat depthFormat;
+        VkRenderPass renderPass = VK_NULL_HANDLE;
+        std::vector<Frame> frames;
+        size_t currentFrame = 0;
+        uint64_t submittedFrames = 0;
+
+        VkBuffer readbackBuffer = VK_NULL_HANDLE;
+        ChronosAllocation readbackAllocation{};
+        VkDeviceSize readbackCapacity = 0;
+    };
+}
@@ -13,19 +13,18 @@
 namespace Chronos {
     ChronosPipeline::ChronosPipeline(
             ChronosDevice &device,
+            ChronosShaderLibrary &shaderLibrary,
             const std::string& vertFilepath,
             const std::string& fragFilepath,
             const PipelineConfigInfo& configInfo)
             : chronosDevice{device}
     {
-        createGraphicsPipeline(vertFilepath, fragFilepath, configInfo);
+        createGraphicsPipeline(shaderLibrary, vertFilepath, fragFilepath, configInfo);
 
     }
 
     ChronosPipeline::~ChronosPipeline()
     {
-        vkDestroyShaderModule(chronosDevice.device(), vertShaderModule, nullptr);
-        vkDestroyShaderModule(chronosDevice.device(), fragShaderModule, nullptr);
         vkDestroyPipeline(chronosDevice.device(), graphicsPipeline, nullptr);
     }
 
@@ -48,6 +47,7 @@ namespace Chronos {
     }
 
     void ChronosPipeline::createGraphicsPipeline(
+            ChronosShaderLibrary &shaderLibrary,
             const std::string& vertFilepath,
             const std::string& fragFilepath,
             const PipelineConfigInfo& configInfo)
@@ -56,16 +56,15 @@ namespace Chronos {
                 "Cannot create graphics pipeline:: no pipelineLayout provided in configInfo");
         assert(configInfo.renderPass != VK_NULL_HANDLE &&
                 "Cannot create graphics pipeline:: no renderPass provided in configInfo");
-        auto vertCode = readFile(vertFilepath);
-        auto fragCode = readFile(fragFilepath);
-
-        createShaderModule(vertCode, &vertShaderModule);
-        createShaderModule(fragCode, &fragShaderModule);
+        // released at the end of this function; the pipeline does not need them
+        auto vertShaderModule = shaderLibrary.loadModule(vertFilepath);
+        auto fragShaderModule = shaderLibrary.loadModule(fragFilepath);
+        validateVertexInputs(vertShaderModule->getReflection(), configInfo.attributeDescriptions, vertFilepath);
 
         VkPipelineShaderStageCreateInfo shaderStages[2];
         shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
         shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
-        shaderStages[0].module = vertShaderModule;
+        shaderStages[0].module = vertShaderModule->getModule();
         shaderStages[0].pName = "main";
         shaderStages[0].flags = 0;
         shaderStages[0].pNext = nullptr;
@@ -73,14 +72,14 @@ namespace Chronos {
 
         shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
         shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-        shaderStages[1].module = fragShaderModule;
+        shaderStages[1].module = fragShaderModule->getModule();
         shaderStages[1].pName = "main";
         shaderStages[1].flags = 0;
         shaderStages[1].pNext = nullptr;
         shaderStages[1].pSpecializationInfo = nullptr;
 
-        auto bindingDescriptions = ChronosModel::Vertex::getBindingDescriptions();
-        auto attributeDescriptions = ChronosModel::Vertex::getAttributeDescriptions();
+        auto& bindingDescriptions = configInfo.bindingDescriptions;
+        auto& attributeDescriptions = configInfo.attributeDescriptions;
         VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
         vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
         vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
@@ -108,24 +107,12 @@ namespace Chronos {
         pipelineInfo.basePipelineIndex = -1;
         pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
-        if (vkCreateGraphicsPipelines(chronosDevice.device(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
+        if (vkCreateGraphicsPipelines(chronosDevice.device(), chronosDevice.pipelineCache(), 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
             throw std::runtime_error("failed to create graphics pipeline!");
         }
 
     }
 
-    void ChronosPipeline::createShaderModule(const std::vector<char>& code, VkShaderModule* shaderModule)
-    {
-        VkShaderModuleCreateInfo createInfo{};
-        createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-        createInfo.codeSize = code.size();
-        createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
-
-        if (vkCreateShaderModule(chronosDevice.device(), &createInfo, nullptr, shaderModule) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create shader module");
-        }
-    }
-
     void ChronosPipeline::bind(VkCommandBuffer commandBuffer)
     {
         vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
@@ -201,6 +188,9 @@ namespace Chronos {
         configInfo.dynamicStateInfo.dynamicStateCount = static_cast<uint32_t>(configInfo.dynamicStateEnables.size());
         configInfo.dynamicStateInfo.flags = 0;
 
+        configInfo.bindingDescriptions = ChronosModel::Vertex::getBindingDescriptions();
+        configInfo.attributeDescriptions = ChronosModel::Vertex::getAttributeDescriptions();
+
     }
 
 }
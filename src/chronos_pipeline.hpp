@@ -1,6 +1,7 @@
 #pragma once
 
 #include "chronos_device.hpp"
+#include "chronos_shader_library.hpp"
 
 #include <cstdint>
 #include <string>
@@ -15,6 +16,8 @@ struct PipelineConfigInfo {
 
     PipelineConfigInfo() = default;
 
+    std::vector<VkVertexInputBindingDescription> bindingDescriptions{};
+    std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
     VkPipelineViewportStateCreateInfo viewportInfo;
     VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo;
     VkPipelineRasterizationStateCreateInfo rasterizationInfo;
@@ -31,8 +34,11 @@ struct PipelineConfigInfo {
 
 class ChronosPipeline {
 public:
+    // The shader modules come from shaderLibrary and are only held while the
+    // pipeline is created.
     ChronosPipeline(
             ChronosDevice &device,
+            ChronosShaderLibrary &shaderLibrary,
             const std::string& vertFilepath,
             const std::string& fragFilepath,
             const PipelineConfigInfo& configInfo);
@@ -44,20 +50,16 @@ public:
     void bind(VkCommandBuffer commandBuffer);
 
     static void defaultPipelineConfigInfo(PipelineConfigInfo& configInfo);
-
-private:
     static std::vector<char> readFile(const std::string& filepath);
 
+private:
     void createGraphicsPipeline(
+            ChronosShaderLibrary &shaderLibrary,
             const std::string& vertFilepath,
             const std::string& fragFilepath,
             const PipelineConfigInfo& configInfo);
-    
-    void createShaderModule(const std::vector<char>& code, VkShaderModule* shaderModule);
 
     ChronosDevice& chronosDevice;
     VkPipeline graphicsPipeline;
-    VkShaderModule vertShaderModule;
-    VkShaderModule fragShaderModule;
 };
 }
@@ -0,0 +1,128 @@
+#include "chronos_pipeline_layout_cache.hpp"
+
+//std
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace Chronos {
+
+    ChronosPipelineLayoutCache::ChronosPipelineLayoutCache(ChronosDevice &device) : chronosDevice{device} {}
+
+    ChronosPipelineLayoutCache::~ChronosPipelineLayoutCache()
+    {
+        for (auto &entry : pipelineLayouts) {
+            vkDestroyPipelineLayout(chronosDevice.device(), entry.second, nullptr);
+        }
+        for (auto &entry : setLayouts) {
+            vkDestroyDescriptorSetLayout(chronosDevice.device(), entry.second, nullptr);
+        }
+    }
+
+    VkPipelineLayout ChronosPipelineLayoutCache::getLayout(const std::vector<const ChronosShaderReflection *> &stages)
+    {
+        std::map<uint32_t, std::vector<VkDescriptorSetLayoutBinding>> sets;
+        VkPushConstantRange pushConstantRange{};
+        for (const auto *stage : stages) {
+            for (const auto &binding : stage->descriptorBindings) {
+                auto &setBindings = sets[binding.set];
+                auto existing = std::find_if(setBindings.begin(), setBindings.end(), [&](const auto &candidate) {
+                    return candidate.binding == binding.binding;
+                });
+                if (existing == setBindings.end()) {
+                    VkDescriptorSetLayoutBinding layoutBinding{};
+                    layoutBinding.binding = binding.binding;
+                    layoutBinding.descriptorType = binding.type;
+                    layoutBinding.descriptorCount = binding.count;
+                    layoutBinding.stageFlags = stage->stage;
+                    setBindings.push_back(layoutBinding);
+                } else if (existing->descriptorType != binding.type || existing->descriptorCount != binding.count) {
+                    throw std::runtime_error(
+                            "shader stages disagree on descriptor set " + std::to_string(binding.set) + " binding " +
+                            std::to_string(binding.binding) + "!");
+                } else {
+                    existing->stageFlags |= stage->stage;
+                }
+            }
+            if (stage->pushConstantSize > 0) {
+                pushConstantRange.size = std::max(pushConstantRange.size, stage->pushConstantSize);
+                pushConstantRange.stageFlags |= stage->stage;
+            }
+        }
+
+        // set numbers index pSetLayouts, so gaps get empty layouts
+        std::vector<VkDescriptorSetLayout> layouts;
+        if (!sets.empty()) {
+            layouts.resize(sets.rbegin()->first + 1);
+            for (uint32_t set = 0; set < layouts.size(); set++) {
+                auto &bindings = sets[set];
+                std::sort(bindings.begin(), bindings.end(), [](const auto &a, const auto &b) {
+                    return a.binding < b.binding;
+                });
+                layouts[set] = findOrCreateSetLayout(bindings);
+            }
+        }
+
+        std::vector<uint64_t> key;
+        for (VkDescriptorSetLayout layout : layouts) {
+            key.push_back(reinterpret_cast<uint64_t>(layout));
+        }
+        key.push_back(pushConstantRange.size);
+        key.push_back(pushConstantRange.stageFlags);
+        auto found = pipelineLayouts.find(key);
+        if (found != pipelineLayouts.end()) {
+            return found->second;
+        }
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(layouts.size());
+        pipelineLayoutInfo.pSetLayouts = layouts.data();
+        pipelineLayoutInfo.pushConstantRangeCount = pushConstantRange.size > 0 ? 1 : 0;
+        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+        VkPipelineLayout pipelineLayout;
+        if (vkCreatePipelineLayout(chronosDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) !=
+                VK_SUCCESS) {
+            throw std::runtime_error("failed to create pipeline layout!");
+        }
+        pipelineLayouts.emplace(std::move(key), pipelineLayout);
+        setLayoutsByPipelineLayout.emplace(pipelineLayout, std::move(layouts));
+        return pipelineLayout;
+    }
+
+    VkDescriptorSetLayout ChronosPipelineLayoutCache::getSetLayout(VkPipelineLayout layout, uint32_t set) const
+    {
+        auto found = setLayoutsByPipelineLayout.find(layout);
+        if (found == setLayoutsByPipelineLayout.end() || set >= found->second.size()) {
+            return VK_NULL_HANDLE;
+        }
+        return found->second[set];
+    }
+
+    VkDescriptorSetLayout ChronosPipelineLayoutCache::findOrCreateSetLayout(
+            const std::vector<VkDescriptorSetLayoutBinding> &bindings)
+    {
+        std::vector<uint32_t> key;
+        for (const auto &binding : bindings) {
+            key.insert(key.end(), {binding.binding, static_cast<uint32_t>(binding.descriptorType),
+                                   binding.descriptorCount, binding.stageFlags});
+        }
+        auto found = setLayouts.find(key);
+        if (found != setLayouts.end()) {
+            return found->second;
+        }
+
+        VkDescriptorSetLayoutCreateInfo layoutInfo{};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+        layoutInfo.pBindings = bindings.data();
+
+        VkDescriptorSetLayout setLayout;
+        if (vkCreateDescriptorSetLayout(chronosDevice.device(), &layoutInfo, nullptr, &setLayout) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create descriptor set layout!");
+        }
+        setLayouts.emplace(std::move(key), setLayout);
+        return setLayout;
+    }
+}
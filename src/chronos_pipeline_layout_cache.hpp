@@ -0,0 +1,43 @@
+#pragma once
+
+#include "chronos_device.hpp"
+#include "chronos_shader_reflection.hpp"
+
+//std
+#include <cstdint>
+#include <map>
+#include <vector>
+
+namespace Chronos {
+
+    // Builds pipeline layouts from shader reflection and shares them by signature.
+    // A layout holds exactly the descriptor sets and push constant range its
+    // shaders declare, each with the stage flags of the stages that declare it.
+    // Descriptor set layouts are shared the same way. Everything lives as long as
+    // the cache.
+    class ChronosPipelineLayoutCache {
+    public:
+        explicit ChronosPipelineLayoutCache(ChronosDevice &device);
+        ~ChronosPipelineLayoutCache();
+
+        ChronosPipelineLayoutCache(const ChronosPipelineLayoutCache &) = delete;
+        ChronosPipelineLayoutCache &operator=(const ChronosPipelineLayoutCache &) = delete;
+
+        // Merges the stages of one pipeline. Throws if two stages declare the same
+        // binding with a different type or count.
+        VkPipelineLayout getLayout(const std::vector<const ChronosShaderReflection *> &stages);
+        // Descriptor set layout number set of a layout returned by getLayout, for
+        // allocating its descriptor sets. Null when the shaders use no such set.
+        VkDescriptorSetLayout getSetLayout(VkPipelineLayout layout, uint32_t set) const;
+
+    private:
+        VkDescriptorSetLayout findOrCreateSetLayout(const std::vector<VkDescriptorSetLayoutBinding> &bindings);
+
+        ChronosDevice &chronosDevice;
+        // keyed by (binding, type, count, stages) per binding
+        std::map<std::vector<uint32_t>, VkDescriptorSetLayout> setLayouts;
+        // keyed by set layout handles, then push constant size and stages
+        std::map<std::vector<uint64_t>, VkPipelineLayout> pipelineLayouts;
+        std::map<VkPipelineLayout, std::vector<VkDescriptorSetLayout>> setLayoutsByPipelineLayout;
+    };
+}
@@ -0,0 +1,321 @@
+#include "chronos_pipeline_registry.hpp"
+#include "chronos_utils.hpp"
+
+//std
+#include <cassert>
+#include <cstring>
+
+namespace Chronos {
+
+    namespace {
+        class StateWriter {
+        public:
+            explicit StateWriter(std::vector<uint64_t> &state) : state{state} {}
+
+            template <typename T>
+            StateWriter &operator<<(const T &value)
+            {
+                state.push_back(static_cast<uint64_t>(value));
+                return *this;
+            }
+
+            StateWriter &operator<<(float value)
+            {
+                uint32_t bits;
+                std::memcpy(&bits, &value, sizeof(bits));
+                state.push_back(bits);
+                return *this;
+            }
+
+            template <typename Handle>
+            StateWriter &handle(Handle value)
+            {
+                state.push_back(reinterpret_cast<uint64_t>(value));
+                return *this;
+            }
+
+        private:
+            std::vector<uint64_t> &state;
+        };
+
+        void writeStencilOp(StateWriter &writer, const VkStencilOpState &op)
+        {
+            writer << op.failOp << op.passOp << op.depthFailOp << op.compareOp << op.compareMask << op.writeMask
+                   << op.reference;
+        }
+
+        // PipelineConfigInfo is not copyable since it points into itself
+        std::unique_ptr<PipelineConfigInfo> copyConfigInfo(const PipelineConfigInfo &from)
+        {
+            auto to = std::make_unique<PipelineConfigInfo>();
+            to->bindingDescriptions = from.bindingDescriptions;
+            to->attributeDescriptions = from.attributeDescriptions;
+            to->viewportInfo = from.viewportInfo;
+            to->inputAssemblyInfo = from.inputAssemblyInfo;
+            to->rasterizationInfo = from.rasterizationInfo;
+            to->multisampleInfo = from.multisampleInfo;
+            to->colorBlendAttachment = from.colorBlendAttachment;
+            to->colorBlendInfo = from.colorBlendInfo;
+            to->depthStencilInfo = from.depthStencilInfo;
+            to->dynamicStateEnables = from.dynamicStateEnables;
+            to->dynamicStateInfo = from.dynamicStateInfo;
+            to->pipelineLayout = from.pipelineLayout;
+            to->renderPass = from.renderPass;
+            to->subpass = from.subpass;
+
+            if (from.colorBlendInfo.pAttachments == &from.colorBlendAttachment) {
+                to->colorBlendInfo.pAttachments = &to->colorBlendAttachment;
+            }
+            if (from.dynamicStateInfo.pDynamicStates == from.dynamicStateEnables.data()) {
+                to->dynamicStateInfo.pDynamicStates = to->dynamicStateEnables.data();
+            }
+            return to;
+        }
+    }
+
+    ChronosPipelineRegistry::ChronosPipelineRegistry(
+            ChronosDevice &device,
+            ChronosShaderLibrary &shaderLibrary,
+            uint32_t compileThreadCount)
+        : chronosDevice{device}, shaderLibrary{shaderLibrary}
+    {
+        for (uint32_t i = 0; i < compileThreadCount; i++) {
+            compileThreads.emplace_back(&ChronosPipelineRegistry::compileLoop, this);
+        }
+    }
+
+    ChronosPipelineRegistry::~ChronosPipelineRegistry()
+    {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            stopping = true;
+        }
+        compileCondition.notify_all();
+        for (auto &thread : compileThreads) {
+            thread.join();
+        }
+    }
+
+    std::shared_ptr<ChronosPipeline> ChronosPipelineRegistry::getPipeline(
+            const std::string &vertFilepath,
+            const std::string &fragFilepath,
+            const PipelineConfigInfo &configInfo)
+    {
+        Key key = makeKey(vertFilepath, fragFilepath, configInfo);
+        std::promise<std::shared_ptr<ChronosPipeline>> promise;
+        PipelineFuture existing;
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            auto found = pipelines.find(key);
+            if (found != pipelines.end()) {
+                hits++;
+                existing = found->second;
+            } else {
+                misses++;
+                pipelines.emplace(key, promise.get_future().share());
+            }
+        }
+        if (existing.valid()) {
+            // waited on unlocked, in case it is still compiling
+            return existing.get();
+        }
+
+        try {
+            auto pipeline = std::make_shared<ChronosPipeline>(
+                    chronosDevice, shaderLibrary, vertFilepath, fragFilepath, configInfo);
+            promise.set_value(pipeline);
+            return pipeline;
+        } catch (...) {
+            // forgotten so a later request can try again
+            {
+                std::lock_guard<std::mutex> lock{mutex};
+                pipelines.erase(key);
+            }
+            promise.set_exception(std::current_exception());
+            throw;
+        }
+    }
+
+    ChronosPipelineRegistry::PipelineFuture ChronosPipelineRegistry::requestPipeline(
+            const std::string &vertFilepath,
+            const std::string &fragFilepath,
+            const PipelineConfigInfo &configInfo)
+    {
+        assert(!compileThreads.empty() && "Registry has no compile threads");
+        Key key = makeKey(vertFilepath, fragFilepath, configInfo);
+        PipelineFuture future;
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            auto found = pipelines.find(key);
+            if (found != pipelines.end()) {
+                hits++;
+                return found->second;
+            }
+            misses++;
+
+            CompileJob job{vertFilepath, fragFilepath, copyConfigInfo(configInfo), {}};
+            future = job.promise.get_future().share();
+            pipelines.emplace(std::move(key), future);
+            compileQueue.push_back(std::move(job));
+        }
+        compileCondition.notify_one();
+        return future;
+    }
+
+    void ChronosPipelineRegistry::compileLoop()
+    {
+        while (true) {
+            CompileJob job;
+            {
+                std::unique_lock<std::mutex> lock{mutex};
+                compileCondition.wait(lock, [this]() { return stopping || !compileQueue.empty(); });
+                if (stopping) {
+                    return;
+                }
+                job = std::move(compileQueue.front());
+                compileQueue.pop_front();
+            }
+
+            try {
+                job.promise.set_value(std::make_shared<ChronosPipeline>(
+                        chronosDevice, shaderLibrary, job.vertFilepath, job.fragFilepath, *job.configInfo));
+            } catch (...) {
+                job.promise.set_exception(std::current_exception());
+            }
+        }
+    }
+
+    size_t ChronosPipelineRegistry::invalidateShader(const std::string &filepath)
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        size_t invalidated = 0;
+        for (auto it = pipelines.begin(); it != pipelines.end();) {
+            if (it->first.vertFilepath == filepath || it->first.fragFilepath == filepath) {
+                it = pipelines.erase(it);
+                invalidated++;
+            } else {
+                ++it;
+            }
+        }
+        return invalidated;
+    }
+
+    size_t ChronosPipelineRegistry::releaseUnused()
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        size_t released = 0;
+        for (auto it = pipelines.begin(); it != pipelines.end();) {
+            bool unused = false;
+            if (isReady(it->second)) {
+                try {
+                    // the future's shared state holds one reference
+                    unused = it->second.get().use_count() == 1;
+                } catch (...) {
+                    unused = true;
+                }
+            }
+            if (unused) {
+                it = pipelines.erase(it);
+                released++;
+            } else {
+                ++it;
+            }
+        }
+        return released;
+    }
+
+    ChronosPipelineRegistry::Stats ChronosPipelineRegistry::getStats()
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        return {hits, misses, pipelines.size()};
+    }
+
+    size_t ChronosPipelineRegistry::KeyHash::operator()(const Key &key) const
+    {
+        size_t seed = 0;
+        hashCombine(seed, key.vertFilepath, key.fragFilepath);
+        for (uint64_t word : key.state) {
+            hashCombine(seed, word);
+        }
+        return seed;
+    }
+
+    ChronosPipelineRegistry::Key ChronosPipelineRegistry::makeKey(
+            const std::string &vertFilepath,
+            const std::string &fragFilepath,
+            const PipelineConfigInfo &configInfo)
+    {
+        Key key{vertFilepath, fragFilepath, {}};
+        StateWriter writer{key.state};
+
+        writer << configInfo.bindingDescriptions.size();
+        for (const auto &binding : configInfo.bindingDescriptions) {
+            writer << binding.binding << binding.stride << binding.inputRate;
+        }
+        writer << configInfo.attributeDescriptions.size();
+        for (const auto &attribute : configInfo.attributeDescriptions) {
+            writer << attribute.location << attribute.binding << attribute.format << attribute.offset;
+        }
+
+        const auto &viewport = configInfo.viewportInfo;
+        writer << viewport.viewportCount << viewport.scissorCount << (viewport.pViewports != nullptr)
+               << (viewport.pScissors != nullptr);
+        for (uint32_t i = 0; viewport.pViewports && i < viewport.viewportCount; i++) {
+            const auto &v = viewport.pViewports[i];
+            writer << v.x << v.y << v.width << v.height << v.minDepth << v.maxDepth;
+        }
+        for (uint32_t i = 0; viewport.pScissors && i < viewport.scissorCount; i++) {
+            const auto &s = viewport.pScissors[i];
+            writer << s.offset.x << s.offset.y << s.extent.width << s.extent.height;
+        }
+
+        const auto &inputAssembly = configInfo.inputAssemblyInfo;
+        writer << inputAssembly.topology << inputAssembly.primitiveRestartEnable;
+
+        const auto &raster = configInfo.rasterizationInfo;
+        writer << raster.depthClampEnable << raster.rasterizerDiscardEnable << raster.polygonMode << raster.cullMode
+               << raster.frontFace << raster.depthBiasEnable << raster.depthBiasConstantFactor
+               << raster.depthBiasClamp << raster.depthBiasSlopeFactor << raster.lineWidth;
+
+        const auto &multisample = configInfo.multisampleInfo;
+        writer << multisample.rasterizationSamples << multisample.sampleShadingEnable << multisample.minSampleShading
+               << (multisample.pSampleMask != nullptr) << multisample.alphaToCoverageEnable
+               << multisample.alphaToOneEnable;
+        if (multisample.pSampleMask) {
+            uint32_t maskWords = (static_cast<uint32_t>(multisample.rasterizationSamples) + 31) / 32;
+            for (uint32_t i = 0; i < maskWords; i++) {
+                writer << multisample.pSampleMask[i];
+            }
+        }
+
+        const auto &blend = configInfo.colorBlendInfo;
+        writer << blend.logicOpEnable << blend.logicOp << blend.attachmentCount;
+        for (uint32_t i = 0; i < blend.attachmentCount; i++) {
+            const auto &attachment = blend.pAttachments[i];
+            writer << attachment.blendEnable << attachment.srcColorBlendFactor << attachment.dstColorBlendFactor
+                   << attachment.colorBlendOp << attachment.srcAlphaBlendFactor << attachment.dstAlphaBlendFactor
+                   << attachment.alphaBlendOp << attachment.colorWriteMask;
+        }
+        for (float constant : blend.blendConstants) {
+            writer << constant;
+        }
+
+        const auto &depth = configInfo.depthStencilInfo;
+        writer << depth.depthTestEnable << depth.depthWriteEnable << depth.depthCompareOp
+               << depth.depthBoundsTestEnable << depth.stencilTestEnable << depth.minDepthBounds
+               << depth.maxDepthBounds;
+        writeStencilOp(writer, depth.front);
+        writeStencilOp(writer, depth.back);
+
+        // what the pipeline is built with, which may differ from dynamicStateEnables
+        const auto &dynamic = configInfo.dynamicStateInfo;
+        writer << dynamic.dynamicStateCount;
+        for (uint32_t i = 0; i < dynamic.dynamicStateCount; i++) {
+            writer << dynamic.pDynamicStates[i];
+        }
+
+        writer.handle(configInfo.pipelineLayout).handle(configInfo.renderPass);
+        writer << configInfo.subpass;
+        return key;
+    }
+}
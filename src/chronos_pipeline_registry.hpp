@@ -0,0 +1,129 @@
+#pragma once
+
+#include "chronos_device.hpp"
+#include "chronos_pipeline.hpp"
+
+//std
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace Chronos {
+
+    // Hands out shared graphics pipelines, keyed by every piece of fixed-function
+    // state in a PipelineConfigInfo plus the shaders, so identical requests share
+    // one VkPipeline instead of compiling it again.
+    //
+    // The render pass and layout are keyed by handle. Pipelines stay usable with
+    // any compatible render pass, but release them before destroying a handle they
+    // were keyed on, or a new object reusing the handle value would hit them.
+    //
+    // Pipelines can also be compiled on the registry's own threads, so a new
+    // variant never stalls the frame that first asks for it. Those threads are not
+    // job system workers: a thread waiting on the job system runs queued jobs
+    // itself, and a compile could land on the render thread.
+    class ChronosPipelineRegistry {
+    public:
+        using PipelineFuture = std::shared_future<std::shared_ptr<ChronosPipeline>>;
+
+        struct Stats {
+            uint64_t hits = 0;
+            uint64_t misses = 0;
+            size_t pipelineCount = 0;
+        };
+
+        ChronosPipelineRegistry(
+                ChronosDevice &device,
+                ChronosShaderLibrary &shaderLibrary,
+                uint32_t compileThreadCount = 1);
+        // Waits for the compile in progress on each thread; queued ones are dropped
+        // and their futures report a broken promise.
+        ~ChronosPipelineRegistry();
+
+        ChronosPipelineRegistry(const ChronosPipelineRegistry &) = delete;
+        ChronosPipelineRegistry &operator=(const ChronosPipelineRegistry &) = delete;
+
+        // Builds on the calling thread on a miss. Waits if the same pipeline is
+        // already being compiled in the background.
+        std::shared_ptr<ChronosPipeline> getPipeline(
+                const std::string &vertFilepath,
+                const std::string &fragFilepath,
+                const PipelineConfigInfo &configInfo);
+        // Queues a miss for a compile thread and returns immediately. The config is
+        // copied, except for what it points to outside itself (viewports, scissors,
+        // sample mask), which has to stay valid until the future is ready.
+        PipelineFuture requestPipeline(
+                const std::string &vertFilepath,
+                const std::string &fragFilepath,
+                const PipelineConfigInfo &configInfo);
+
+        static bool isReady(const PipelineFuture &future)
+        {
+            return future.valid() && future.wait_for(std::chrono::seconds{0}) == std::future_status::ready;
+        }
+
+        // Forgets every pipeline built from the shader at filepath, so the next request
+        // compiles it again from the file's current contents. Callers keep the
+        // pipelines they hold. Returns how many were forgotten.
+        size_t invalidateShader(const std::string &filepath);
+
+        // Forgets the pipelines no caller holds anymore, and failed compiles, and
+        // returns how many. Pending compiles are kept.
+        size_t releaseUnused();
+
+        Stats getStats();
+
+    private:
+        struct Key {
+            std::string vertFilepath;
+            std::string fragFilepath;
+            // the config's state, flattened field by field so padding and pNext never leak in
+            std::vector<uint64_t> state;
+
+            bool operator==(const Key &other) const
+            {
+                return state == other.state && vertFilepath == other.vertFilepath &&
+                       fragFilepath == other.fragFilepath;
+            }
+        };
+
+        struct KeyHash {
+            size_t operator()(const Key &key) const;
+        };
+
+        struct CompileJob {
+            std::string vertFilepath;
+            std::string fragFilepath;
+            std::unique_ptr<PipelineConfigInfo> configInfo;
+            std::promise<std::shared_ptr<ChronosPipeline>> promise;
+        };
+
+        static Key makeKey(
+                const std::string &vertFilepath,
+                const std::string &fragFilepath,
+                const PipelineConfigInfo &configInfo);
+        void compileLoop();
+
+        ChronosDevice &chronosDevice;
+        ChronosShaderLibrary &shaderLibrary;
+
+        std::mutex mutex;
+        std::condition_variable compileCondition;
+        std::unordered_map<Key, PipelineFuture, KeyHash> pipelines;
+        std::deque<CompileJob> compileQueue;
+        bool stopping = false;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+
+        std::vector<std::thread> compileThreads;
+    };
+}
@@ -0,0 +1,192 @@
+#include "chronos_render_snapshot.hpp"
+
+//std
+#include <algorithm>
+#include <cassert>
+
+namespace Chronos {
+
+    ChronosSnapshotQueue::ChronosSnapshotQueue(uint32_t depth) : slots(depth)
+    {
+        assert(depth >= 2 && "Snapshot queue needs a slot to draw and one to fill");
+        for (uint32_t i = 0; i < depth; i++) {
+            freeSlots.push_back(i);
+        }
+    }
+
+    bool ChronosSnapshotQueue::publish(
+            ChronosRegistry &registry,
+            const ChronosTransformHierarchy &hierarchy,
+            std::chrono::steady_clock::time_point simulationStart,
+            std::chrono::steady_clock::time_point tickTime)
+    {
+        uint32_t slotIndex;
+        {
+            std::unique_lock<std::mutex> lock{mutex};
+            condition.wait(lock, [this]() { return closed || !freeSlots.empty(); });
+            if (closed) {
+                return false;
+            }
+            slotIndex = freeSlots.front();
+            freeSlots.pop_front();
+        }
+
+        // The renderer may be reading other slots' snapshots meanwhile, but it never
+        // touches their producer-side fields or this slot.
+        bool structureChanged = needsReindex(registry);
+        if (structureChanged) {
+            reindex(registry);
+            for (auto &slot : slots) {
+                slot.needsFullCopy = true;
+                slot.pendingChanges.clear();
+            }
+        } else {
+            collectChanges(registry);
+        }
+
+        Slot &slot = slots[slotIndex];
+        ChronosRenderSnapshot &snapshot = slot.snapshot;
+        if (slot.needsFullCopy) {
+            snapshot.objects.resize(entityByObject.size());
+            for (size_t i = 0; i < entityByObject.size(); i++) {
+                writeObject(snapshot.objects[i], entityByObject[i], registry, hierarchy);
+            }
+            slot.needsFullCopy = false;
+        } else {
+            // objects that were moving when this slot was last written have since come to rest
+            for (uint32_t object : snapshot.changedObjects) {
+                snapshot.objects[object].previousTransform = snapshot.objects[object].transform;
+                snapshot.objects[object].previousOffset = snapshot.objects[object].offset;
+            }
+            for (uint32_t object : slot.pendingChanges) {
+                writeObject(snapshot.objects[object], entityByObject[object], registry, hierarchy);
+            }
+            for (uint32_t object : changes) {
+                writeObject(snapshot.objects[object], entityByObject[object], registry, hierarchy);
+            }
+        }
+        slot.pendingChanges.clear();
+
+        // movers start from where the last published snapshot left them; after a
+        // reindex there is nothing to match against, so they jump
+        if (!structureChanged && lastPublishedSlot != UINT32_MAX) {
+            const auto &lastObjects = slots[lastPublishedSlot].snapshot.objects;
+            for (uint32_t object : changes) {
+                snapshot.objects[object].previousTransform = lastObjects[object].transform;
+                snapshot.objects[object].previousOffset = lastObjects[object].offset;
+            }
+        }
+
+        // a slot that fell far behind is cheaper to copy whole
+        for (auto &other : slots) {
+            if (&other == &slot || other.needsFullCopy) continue;
+            other.pendingChanges.insert(other.pendingChanges.end(), changes.begin(), changes.end());
+            if (other.pendingChanges.size() > entityByObject.size()) {
+                other.needsFullCopy = true;
+                other.pendingChanges.clear();
+            }
+        }
+
+        snapshot.changedObjects = changes;
+        snapshot.structureChanged = structureChanged;
+        snapshot.frameNumber = ++publishedFrames;
+        snapshot.simulationStart = simulationStart;
+        snapshot.tickTime = tickTime;
+        lastPublishedSlot = slotIndex;
+
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            queuedSlots.push_back(slotIndex);
+        }
+        condition.notify_all();
+        return true;
+    }
+
+    const ChronosRenderSnapshot *ChronosSnapshotQueue::next(std::chrono::milliseconds timeout)
+    {
+        {
+            std::unique_lock<std::mutex> lock{mutex};
+            if (!condition.wait_for(lock, timeout, [this]() { return closed || !queuedSlots.empty(); }) || closed) {
+                return nullptr;
+            }
+            if (acquiredSlot != UINT32_MAX) {
+                freeSlots.push_back(acquiredSlot);
+            }
+            acquiredSlot = queuedSlots.front();
+            queuedSlots.pop_front();
+        }
+        condition.notify_all();
+        return &slots[acquiredSlot].snapshot;
+    }
+
+    void ChronosSnapshotQueue::close()
+    {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            closed = true;
+        }
+        condition.notify_all();
+    }
+
+    bool ChronosSnapshotQueue::needsReindex(ChronosRegistry &registry) const
+    {
+        auto &models = registry.pool<ModelComponent>();
+        return !models.getDirtyIndices().empty() || models.getStructureVersion() != indexedModelVersion ||
+               registry.pool<Transform2dComponent>().getStructureVersion() != indexedTransformVersion ||
+               registry.pool<ColorComponent>().getStructureVersion() != indexedColorVersion;
+    }
+
+    void ChronosSnapshotQueue::reindex(ChronosRegistry &registry)
+    {
+        indexedModelVersion = registry.pool<ModelComponent>().getStructureVersion();
+        indexedTransformVersion = registry.pool<Transform2dComponent>().getStructureVersion();
+        indexedColorVersion = registry.pool<ColorComponent>().getStructureVersion();
+
+        std::fill(objectByEntity.begin(), objectByEntity.end(), UINT32_MAX);
+        entityByObject.clear();
+        changes.clear();
+        auto view = registry.view<ModelComponent, Transform2dComponent, ColorComponent>();
+        view.each([&](ChronosEntity entity, ModelComponent &, Transform2dComponent &, ColorComponent &) {
+            if (entity.index >= objectByEntity.size()) {
+                objectByEntity.resize(entity.index + 1, UINT32_MAX);
+            }
+            objectByEntity[entity.index] = static_cast<uint32_t>(entityByObject.size());
+            entityByObject.push_back(entity);
+        });
+    }
+
+    void ChronosSnapshotQueue::collectChanges(ChronosRegistry &registry)
+    {
+        changes.clear();
+        auto collect = [&](auto &pool) {
+            for (uint32_t index : pool.getDirtyIndices()) {
+                if (index >= pool.size()) continue;
+                ChronosEntity entity = pool.entityAt(index);
+                if (entity.index < objectByEntity.size() && objectByEntity[entity.index] != UINT32_MAX) {
+                    changes.push_back(objectByEntity[entity.index]);
+                }
+            }
+        };
+        collect(registry.pool<Transform2dComponent>());
+        collect(registry.pool<ColorComponent>());
+
+        std::sort(changes.begin(), changes.end());
+        changes.erase(std::unique(changes.begin(), changes.end()), changes.end());
+    }
+
+    void ChronosSnapshotQueue::writeObject(
+            ChronosRenderObject &object,
+            ChronosEntity entity,
+            ChronosRegistry &registry,
+            const ChronosTransformHierarchy &hierarchy)
+    {
+        auto &transforms = registry.pool<Transform2dComponent>();
+        size_t transformIndex = transforms.indexOf(transforms.get(entity));
+        object.model = registry.get<ModelComponent>(entity).model;
+        object.transform = hierarchy.worldMatrix(transformIndex);
+        object.offset = hierarchy.worldOffset(transformIndex);
+        object.color = registry.get<ColorComponent>(entity).color;
+        object.previousTransform = object.transform;
+        object.previousOffset = object.offset;
+    }
+}
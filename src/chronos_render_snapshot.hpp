@@ -0,0 +1,133 @@
+#pragma once
+
+#include "chronos_components.hpp"
+#include "chronos_ecs.hpp"
+#include "chronos_transform_hierarchy.hpp"
+
+//std
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Chronos {
+
+    // Everything the renderer needs to draw one object, resolved to world space.
+    // previous* hold the world transform one simulation step earlier, for objects
+    // that moved during the step; otherwise they equal the current values.
+    struct ChronosRenderObject {
+        std::shared_ptr<ChronosModel> model;
+        glm::mat2 transform{1.f};
+        glm::vec2 offset{};
+        glm::vec3 color{};
+        glm::mat2 previousTransform{1.f};
+        glm::vec2 previousOffset{};
+
+        // Blends elementwise, which is close enough to the true rotation over one step.
+        glm::mat2 interpolatedTransform(float alpha) const
+        {
+            return previousTransform * (1.f - alpha) + transform * alpha;
+        }
+        glm::vec2 interpolatedOffset(float alpha) const { return glm::mix(previousOffset, offset, alpha); }
+    };
+
+    // Render-side copy of the scene for one simulated frame. The render paths only
+    // read snapshots, never the registry, so simulation can run on another thread.
+    struct ChronosRenderSnapshot {
+        std::vector<ChronosRenderObject> objects;
+        // Indices into objects that differ from the previous snapshot. When
+        // structureChanged is set, indices were reassigned and every object is new.
+        std::vector<uint32_t> changedObjects;
+        bool structureChanged = true;
+
+        uint64_t frameNumber = 0;
+        std::chrono::steady_clock::time_point simulationStart{};
+        // Wall time at which the previous state is shown; the current state is reached
+        // one timestep later.
+        std::chrono::steady_clock::time_point tickTime{};
+
+        // blend factor between the previous and current state at `now`
+        float interpolationAlpha(std::chrono::steady_clock::time_point now, std::chrono::duration<double> timestep) const
+        {
+            double alpha = std::chrono::duration<double>(now - tickTime).count() / timestep.count();
+            return static_cast<float>(alpha < 0.0 ? 0.0 : alpha > 1.0 ? 1.0 : alpha);
+        }
+    };
+
+    // Fixed ring of snapshots handed from the simulation to the renderer in order.
+    // publish() blocks while every slot is queued or being drawn, so simulation runs
+    // at most depth - 1 frames ahead. The renderer keeps the latest snapshot and may
+    // draw it repeatedly, interpolating, until a newer one is queued.
+    //
+    // Slots are refreshed incrementally: each keeps the changes published since it
+    // was last written and copies only those objects, so a static scene costs
+    // nothing per frame. Objects are re-extracted in full when entities or models
+    // are added, removed or swapped.
+    class ChronosSnapshotQueue {
+    public:
+        static constexpr uint32_t DEFAULT_DEPTH = 3;
+
+        explicit ChronosSnapshotQueue(uint32_t depth = DEFAULT_DEPTH);
+
+        ChronosSnapshotQueue(const ChronosSnapshotQueue &) = delete;
+        ChronosSnapshotQueue &operator=(const ChronosSnapshotQueue &) = delete;
+
+        // Producer side. Extracts the registry's renderable entities into a free slot
+        // and queues it. The hierarchy must be updated and the registry's dirty lists
+        // not yet cleared. Returns false once the queue is closed.
+        bool publish(
+                ChronosRegistry &registry,
+                const ChronosTransformHierarchy &hierarchy,
+                std::chrono::steady_clock::time_point simulationStart,
+                std::chrono::steady_clock::time_point tickTime);
+
+        // Consumer side. Waits up to timeout for the next queued snapshot; if one
+        // arrives the previously returned snapshot is handed back and the new one
+        // returned. Returns nullptr on timeout or once closed, and the previous
+        // snapshot stays valid.
+        const ChronosRenderSnapshot *next(std::chrono::milliseconds timeout);
+
+        // Wakes and fails every blocked publish() and next().
+        void close();
+
+    private:
+        struct Slot {
+            ChronosRenderSnapshot snapshot;
+            // producer only: changes published since this slot was last written
+            std::vector<uint32_t> pendingChanges;
+            bool needsFullCopy = true;
+        };
+
+        bool needsReindex(ChronosRegistry &registry) const;
+        void reindex(ChronosRegistry &registry);
+        void collectChanges(ChronosRegistry &registry);
+        // writes the current state with no motion
+        void writeObject(
+                ChronosRenderObject &object,
+                ChronosEntity entity,
+                ChronosRegistry &registry,
+                const ChronosTransformHierarchy &hierarchy);
+
+        std::vector<Slot> slots;
+
+        std::mutex mutex;
+        std::condition_variable condition;
+        std::deque<uint32_t> freeSlots;
+        std::deque<uint32_t> queuedSlots;
+        uint32_t acquiredSlot = UINT32_MAX;
+        bool closed = false;
+
+        // producer only
+        uint32_t lastPublishedSlot = UINT32_MAX;
+        std::vector<uint32_t> objectByEntity;
+        std::vector<ChronosEntity> entityByObject;
+        std::vector<uint32_t> changes;
+        uint64_t indexedModelVersion = UINT64_MAX;
+        uint64_t indexedTransformVersion = UINT64_MAX;
+        uint64_t indexedColorVersion = UINT64_MAX;
+        uint64_t publishedFrames = 0;
+    };
+}
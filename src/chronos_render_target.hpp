@@ -0,0 +1,32 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+//std
+#include <cstddef>
+#include <cstdint>
+
+namespace Chronos {
+
+    // Images the renderer records into, behind a ring of frames in flight that are
+    // each guarded by a fence. The swap chain presents them; the offscreen target
+    // keeps them for readback when running headless.
+    class ChronosRenderTarget {
+    public:
+        virtual ~ChronosRenderTarget() = default;
+
+        virtual VkRenderPass getRenderPass() = 0;
+        virtual VkFramebuffer getFrameBuffer(int index) = 0;
+        virtual VkExtent2D getExtent() = 0;
+        virtual uint32_t getFramesInFlight() = 0;
+        // frame-in-flight slot; its previous submission has completed once acquireNextImage returns
+        virtual size_t getCurrentFrame() = 0;
+        // slot of the most recent submission
+        virtual size_t getPreviousFrame() = 0;
+
+        // Blocks until the given slot's last submission has completed.
+        virtual void waitForFrame(size_t frameIndex) = 0;
+        virtual VkResult acquireNextImage(uint32_t *imageIndex) = 0;
+        virtual VkResult submitCommandBuffers(const VkCommandBuffer *buffers, uint32_t *imageIndex) = 0;
+    };
+}
@@ -1,78 +1,197 @@
 #include "chronos_renderer.hpp"
+#include "chronos_staging_ring.hpp"
 
 //std
+#include <algorithm>
 #include <array>
 #include <cassert>
+#include <chrono>
 #include <stdexcept>
+#include <thread>
 #include <vector>
 
 namespace Chronos {
 
-    ChronosRenderer::ChronosRenderer(ChronosWindow &window, ChronosDevice &device) : chronosWindow{window}, chronosDevice{device}
+    ChronosRenderer::ChronosRenderer(
+            ChronosWindow &window,
+            ChronosDevice &device,
+            const ChronosPresentConfig &presentConfig,
+            uint32_t recordingThreads)
+        : chronosWindow{&window}, chronosDevice{device}, presentConfig{presentConfig}
     {
+        workerCount = recordingThreads > 0 ? recordingThreads : std::max(1u, std::thread::hardware_concurrency());
         recreateSwapChain();
-        createCommandBuffers();
+        createFrameContexts();
+        createTimestampQueries();
+    }
+
+    ChronosRenderer::ChronosRenderer(
+            ChronosDevice &device,
+            VkExtent2D extent,
+            const ChronosPresentConfig &presentConfig,
+            uint32_t recordingThreads)
+        : chronosDevice{device}, presentConfig{presentConfig}
+    {
+        workerCount = recordingThreads > 0 ? recordingThreads : std::max(1u, std::thread::hardware_concurrency());
+        offscreenTarget =
+                std::make_unique<ChronosOffscreenTarget>(chronosDevice, extent, presentConfig.framesInFlight);
+        renderTarget = offscreenTarget.get();
+        createFrameContexts();
+        createTimestampQueries();
     }
 
     ChronosRenderer::~ChronosRenderer()
     {
-        freeCommandBuffers();
+        if (timestampPool != VK_NULL_HANDLE)
+        {
+            vkDestroyQueryPool(chronosDevice.device(), timestampPool, nullptr);
+        }
+    }
+
+    void ChronosRenderer::createTimestampQueries()
+    {
+        frameTimestamped.assign(presentConfig.framesInFlight, false);
+        if (!chronosDevice.properties.limits.timestampComputeAndGraphics)
+        {
+            return;
+        }
+
+        VkQueryPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        poolInfo.queryCount = 2 * presentConfig.framesInFlight;
+        if (vkCreateQueryPool(chronosDevice.device(), &poolInfo, nullptr, &timestampPool) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create timestamp query pool!");
+        }
+    }
+
+    void ChronosRenderer::readTimestamps(size_t frameIndex)
+    {
+        if (!frameTimestamped[frameIndex])
+        {
+            return;
+        }
+        frameTimestamped[frameIndex] = false;
+
+        uint64_t timestamps[2];
+        if (vkGetQueryPoolResults(
+                    chronosDevice.device(),
+                    timestampPool,
+                    static_cast<uint32_t>(2 * frameIndex),
+                    2,
+                    sizeof(timestamps),
+                    timestamps,
+                    sizeof(uint64_t),
+                    VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)
+        {
+            double ticks = static_cast<double>(timestamps[1] - timestamps[0]);
+            gpuMilliseconds = ticks * chronosDevice.properties.limits.timestampPeriod / 1e6;
+        }
     }
 
     void ChronosRenderer::recreateSwapChain()
     {
-        auto extent = chronosWindow.getExtent();
+        auto extent = chronosWindow->getExtent();
         while (extent.width == 0 || extent.height == 0) 
         {
-            extent = chronosWindow.getExtent();
+            extent = chronosWindow->getExtent();
             glfwWaitEvents();
         }
-        vkDeviceWaitIdle(chronosDevice.device());
 
         if (chronosSwapChain == nullptr) 
         {
-            chronosSwapChain = std::make_unique<ChronosSwapChain>(chronosDevice, extent);
+            chronosSwapChain = std::make_unique<ChronosSwapChain>(chronosDevice, extent, presentConfig);
         } else {
-            chronosSwapChain = std::make_unique<ChronosSwapChain>(chronosDevice, extent, std::move(chronosSwapChain));
-            if (chronosSwapChain->imageCount() != commandBuffers.size())
-            {
-                freeCommandBuffers();
-                createCommandBuffers();
-            }
+            // The old chain is retired through oldSwapchain rather than waiting for the
+            // device to idle; frames already submitted to it finish in the background.
+            std::shared_ptr<ChronosSwapChain> previous = std::move(chronosSwapChain);
+            chronosSwapChain = std::make_unique<ChronosSwapChain>(chronosDevice, extent, presentConfig, previous);
+            retire(std::move(previous));
         }
-        // come back here
+        renderTarget = chronosSwapChain.get();
     }
 
-    void ChronosRenderer::createCommandBuffers() 
+    void ChronosRenderer::retire(std::shared_ptr<void> resource)
     {
-        commandBuffers.resize(chronosSwapChain->imageCount());
+        retiredResources.push_back({std::move(resource), submittedFrames + presentConfig.framesInFlight - 1});
+    }
 
-        VkCommandBufferAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        allocInfo.commandPool = chronosDevice.getCommandPool();
-        allocInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
+    void ChronosRenderer::destroyIdleResources()
+    {
+        // acquireNextImage has just waited on the fence from framesInFlight submissions ago
+        retiredResources.erase(
+                std::remove_if(
+                        retiredResources.begin(),
+                        retiredResources.end(),
+                        [this](const RetiredResource &retired) { return submittedFrames >= retired.idleFromFrame; }),
+                retiredResources.end());
+    }
 
-        if (vkAllocateCommandBuffers(chronosDevice.device(), &allocInfo, commandBuffers.data()) != VK_SUCCESS)
+    void ChronosRenderer::createFrameContexts()
+    {
+        for (uint32_t i = 0; i < presentConfig.framesInFlight; i++)
         {
-            throw std::runtime_error("Failed to allocate command buffers!");
+            frameContexts.push_back(std::make_unique<ChronosFrameContext>(chronosDevice, workerCount));
         }
+        frameInputTimes.assign(presentConfig.framesInFlight, {});
     }
 
-    void ChronosRenderer::freeCommandBuffers()
+    void ChronosRenderer::setPresentMode(VkPresentModeKHR presentMode)
     {
-        vkFreeCommandBuffers(
-                chronosDevice.device(),
-                chronosDevice.getCommandPool(),
-                static_cast<uint32_t>(commandBuffers.size()),
-                commandBuffers.data());
-        commandBuffers.clear();
+        presentConfig.presentMode = presentMode;
+        presentModeChanged = true;
+    }
+
+    void ChronosRenderer::waitForNextFrame()
+    {
+        assert(!isFrameStarted && "Can't wait for the next frame while one is in progress");
+
+        size_t frameIndex = presentConfig.lowLatency ? renderTarget->getPreviousFrame()
+                                                     : renderTarget->getCurrentFrame();
+        renderTarget->waitForFrame(frameIndex);
+
+        inputTime = std::chrono::steady_clock::now();
+        inputSampled = true;
+        collectLatency(frameIndex, inputTime);
+    }
+
+    ChronosRenderer::LatencyStats ChronosRenderer::takeLatencyStats()
+    {
+        LatencyStats taken = latencyStats;
+        latencyStats = {};
+        return taken;
+    }
+
+    void ChronosRenderer::collectLatency(size_t frameIndex, std::chrono::steady_clock::time_point now)
+    {
+        auto &sampled = frameInputTimes[frameIndex];
+        if (sampled == std::chrono::steady_clock::time_point{})
+        {
+            return;
+        }
+        std::chrono::duration<double, std::milli> latency = now - sampled;
+        latencyStats.totalMilliseconds += latency.count();
+        latencyStats.maxMilliseconds = std::max(latencyStats.maxMilliseconds, latency.count());
+        latencyStats.samples++;
+        sampled = {};
     }
 
     VkCommandBuffer ChronosRenderer::beginFrame()
     {
         assert(!isFrameStarted && "Can't call beginFrame while already in progress");
-        auto result = chronosSwapChain->acquireNextImage(&currentImageIndex);
+
+        if (presentModeChanged && !isHeadless())
+        {
+            presentModeChanged = false;
+            recreateSwapChain();
+        }
+
+        // submit pending uploads so they overlap with this frame
+        chronosDevice.stagingRing().flush();
+
+        auto result = renderTarget->acquireNextImage(&currentImageIndex);
+        destroyIdleResources();
 
         if (result == VK_ERROR_OUT_OF_DATE_KHR)
         {
@@ -87,6 +206,18 @@ namespace Chronos {
 
         isFrameStarted = true;
 
+        // the fence for this slot was waited on in acquireNextImage, so its buffers are idle
+        currentFrameIndex = renderTarget->getCurrentFrame();
+        auto now = std::chrono::steady_clock::now();
+        collectLatency(currentFrameIndex, now);
+        readTimestamps(currentFrameIndex);
+        if (!inputSampled)
+        {
+            inputTime = now;
+        }
+        frameContexts[currentFrameIndex]->reset();
+        currentCommandBuffer = frameContexts[currentFrameIndex]->allocatePrimary();
+
         auto commandBuffer = getCurrentCommandBuffer();
 
         VkCommandBufferBeginInfo beginInfo{};
@@ -97,6 +228,16 @@ namespace Chronos {
             throw std::runtime_error("failed to begin recording command buffer!");
         }
 
+        if (timestampPool != VK_NULL_HANDLE)
+        {
+            uint32_t firstQuery = static_cast<uint32_t>(2 * currentFrameIndex);
+            vkCmdResetQueryPool(commandBuffer, timestampPool, firstQuery, 2);
+            vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampPool, firstQuery);
+        }
+
+        // take ownership of anything the transfer queue finished since last frame
+        chronosDevice.stagingRing().recordQueueAcquires(commandBuffer);
+
         return commandBuffer;
     }
     void ChronosRenderer::endFrame()
@@ -104,14 +245,28 @@ namespace Chronos {
         assert(isFrameStarted && "Can't call endFrame while frame is not in progress");
         auto commandBuffer = getCurrentCommandBuffer();
 
+        if (timestampPool != VK_NULL_HANDLE)
+        {
+            vkCmdWriteTimestamp(
+                    commandBuffer,
+                    VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                    timestampPool,
+                    static_cast<uint32_t>(2 * currentFrameIndex + 1));
+            frameTimestamped[currentFrameIndex] = true;
+        }
+
         if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
         {
             throw std::runtime_error("failed to record command buffer!");
         }
-        auto result = chronosSwapChain->submitCommandBuffers(&commandBuffer, &currentImageIndex);
-        if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || chronosWindow.wasWindowResized())
+        auto result = renderTarget->submitCommandBuffers(&commandBuffer, &currentImageIndex);
+        submittedFrames++;
+        frameInputTimes[currentFrameIndex] = inputTime;
+        inputSampled = false;
+        if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR ||
+            (chronosWindow && chronosWindow->wasWindowResized()))
         {
-            chronosWindow.resetWindowResizedFlag();
+            chronosWindow->resetWindowResizedFlag();
             recreateSwapChain();
         } else if (result != VK_SUCCESS)
         {
@@ -119,18 +274,18 @@ namespace Chronos {
         }
         isFrameStarted = false;
     }
-    void ChronosRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer)
+    void ChronosRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer, VkSubpassContents contents)
     {
         assert(isFrameStarted && "Can't call beginSwapChainRenderPass if frame is not in progress");
         assert(commandBuffer == getCurrentCommandBuffer() && "Can't begin render pass on command buffer from a different frame");
 
         VkRenderPassBeginInfo renderPassInfo{};
         renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-        renderPassInfo.renderPass = chronosSwapChain->getRenderPass();
-        renderPassInfo.framebuffer = chronosSwapChain->getFrameBuffer(currentImageIndex);
+        renderPassInfo.renderPass = renderTarget->getRenderPass();
+        renderPassInfo.framebuffer = renderTarget->getFrameBuffer(currentImageIndex);
 
         renderPassInfo.renderArea.offset = {0,0};
-        renderPassInfo.renderArea.extent = chronosSwapChain->getSwapChainExtent();
+        renderPassInfo.renderArea.extent = renderTarget->getExtent();
 
         std::array<VkClearValue, 2> clearValues{};
         clearValues[0].color = {0.01f, 0.01f, 0.01f, 1.0f};
@@ -138,16 +293,26 @@ namespace Chronos {
         renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
         renderPassInfo.pClearValues = clearValues.data();
         
-        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, contents);
+
+        // only vkCmdExecuteCommands is allowed in a secondary-contents subpass;
+        // each secondary sets its own dynamic state instead
+        if (contents == VK_SUBPASS_CONTENTS_INLINE)
+        {
+            setViewportAndScissor(commandBuffer);
+        }
+    }
 
+    void ChronosRenderer::setViewportAndScissor(VkCommandBuffer commandBuffer)
+    {
         VkViewport viewport{};
         viewport.x = 0.0f;
         viewport.y = 0.0f;
-        viewport.width = static_cast<float>(chronosSwapChain->getSwapChainExtent().width);
-        viewport.height = static_cast<float>(chronosSwapChain->getSwapChainExtent().height);
+        viewport.width = static_cast<float>(renderTarget->getExtent().width);
+        viewport.height = static_cast<float>(renderTarget->getExtent().height);
         viewport.minDepth = 0.0f;
         viewport.maxDepth = 1.0f;
-        VkRect2D scissor{{0,0}, chronosSwapChain->getSwapChainExtent()};
+        VkRect2D scissor{{0,0}, renderTarget->getExtent()};
         vkCmdSetViewport(commandBuffer, 0,1, &viewport);
         vkCmdSetScissor(commandBuffer, 0,1, &scissor);
     }
@@ -160,4 +325,53 @@ namespace Chronos {
 
     }
 
+    VkCommandBuffer ChronosRenderer::beginSecondaryCommandBuffer(uint32_t workerIndex)
+    {
+        assert(isFrameStarted && "Can't begin secondary command buffer if frame is not in progress");
+        assert(workerIndex < workerCount && "Worker index out of range");
+
+        VkCommandBuffer commandBuffer = frameContexts[currentFrameIndex]->allocateSecondary(workerIndex);
+
+        VkCommandBufferInheritanceInfo inheritanceInfo{};
+        inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        inheritanceInfo.renderPass = renderTarget->getRenderPass();
+        inheritanceInfo.subpass = 0;
+        inheritanceInfo.framebuffer = renderTarget->getFrameBuffer(currentImageIndex);
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+        beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+        if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to begin recording secondary command buffer!");
+        }
+        setViewportAndScissor(commandBuffer);
+        return commandBuffer;
+    }
+
+    void ChronosRenderer::endSecondaryCommandBuffer(VkCommandBuffer commandBuffer)
+    {
+        if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to record secondary command buffer!");
+        }
+    }
+
+    void ChronosRenderer::executeSecondaryCommandBuffers(
+            VkCommandBuffer commandBuffer,
+            const std::vector<VkCommandBuffer> &secondaryCommandBuffers)
+    {
+        assert(isFrameStarted && "Can't execute secondary command buffers if frame is not in progress");
+        assert(commandBuffer == getCurrentCommandBuffer() && "Can't execute on command buffer from a different frame");
+
+        if (!secondaryCommandBuffers.empty())
+        {
+            vkCmdExecuteCommands(
+                    commandBuffer,
+                    static_cast<uint32_t>(secondaryCommandBuffers.size()),
+                    secondaryCommandBuffers.data());
+        }
+    }
 }
@@ -1,10 +1,15 @@
 #pragma once
 
 #include "chronos_device.hpp"
+#include "chronos_frame_context.hpp"
+#include "chronos_offscreen_target.hpp"
+#include "chronos_render_target.hpp"
 #include "chronos_swap_chain.hpp"
 #include "chronos_window.hpp"
 
 //std
+#include <chrono>
+#include <cstdint>
 #include <memory>
 #include <vector>
 #include <cassert>
@@ -14,39 +19,142 @@ namespace Chronos {
     public:
 
     public:
-        ChronosRenderer(ChronosWindow &window, ChronosDevice &device);
+        struct LatencyStats {
+            double totalMilliseconds = 0.0;
+            double maxMilliseconds = 0.0;
+            uint32_t samples = 0;
+        };
+
+        // recordingThreads of 0 uses one worker per hardware thread. The number of
+        // frames in flight is fixed for the renderer's lifetime.
+        ChronosRenderer(
+                ChronosWindow &window,
+                ChronosDevice &device,
+                const ChronosPresentConfig &presentConfig = {},
+                uint32_t recordingThreads = 0);
+        // Headless: renders into an offscreen target of the given size instead of a
+        // swap chain. The present mode is ignored.
+        ChronosRenderer(
+                ChronosDevice &device,
+                VkExtent2D extent,
+                const ChronosPresentConfig &presentConfig = {},
+                uint32_t recordingThreads = 0);
         ~ChronosRenderer();
 
         ChronosRenderer(const ChronosRenderer &) = delete;
         ChronosRenderer &operator=(const ChronosRenderer &) = delete;
 
-        VkRenderPass getSwapChainRenderPass() const { return chronosSwapChain->getRenderPass(); }
+        VkRenderPass getSwapChainRenderPass() const { return renderTarget->getRenderPass(); }
+        bool isHeadless() const { return chronosWindow == nullptr; }
         bool isFrameInProgress() const { return isFrameStarted;}
 
+        size_t getFrameIndex() const
+        {
+            assert(isFrameStarted && "Cannot get frame index when frame is not in progress");
+            return currentFrameIndex;
+        }
+
         VkCommandBuffer getCurrentCommandBuffer() const 
         {
             assert(isFrameStarted && "Cannot get command buffer when frame is not in progress");
-            return commandBuffers[currentImageIndex];
+            return currentCommandBuffer;
+        }
+
+        uint32_t getWorkerCount() const { return workerCount; }
+        uint32_t getFramesInFlight() const { return presentConfig.framesInFlight; }
+        // headless frames are never held back by presentation
+        VkPresentModeKHR getPresentMode() const
+        {
+            return chronosSwapChain ? chronosSwapChain->getPresentMode() : VK_PRESENT_MODE_IMMEDIATE_KHR;
+        }
+        ChronosOffscreenTarget &getOffscreenTarget() const
+        {
+            assert(offscreenTarget && "Only a headless renderer has an offscreen target");
+            return *offscreenTarget;
         }
+        // the mode asked for, before the surface's fallbacks
+        VkPresentModeKHR getPreferredPresentMode() const { return presentConfig.presentMode; }
+        bool isLowLatency() const { return presentConfig.lowLatency; }
+
+        // Recreates the swap chain at the next beginFrame.
+        void setPresentMode(VkPresentModeKHR presentMode);
+        void setLowLatency(bool lowLatency) { presentConfig.lowLatency = lowLatency; }
+
+        // Blocks until the next frame can be recorded; sample input right after it.
+        // In low-latency mode it waits for the GPU to finish the previous frame too,
+        // so new input never queues behind older frames.
+        void waitForNextFrame();
+        // Time from input being sampled to the frame's fence being seen signalled, an
+        // upper bound on when the GPU finished it. Cleared on read.
+        LatencyStats takeLatencyStats();
+        // GPU time of the most recently collected frame, from timestamps written at the
+        // start and end of its command buffer. Negative when timestamps are unsupported.
+        double getGpuMilliseconds() const { return gpuMilliseconds; }
+
+        // Keeps resource alive until every frame submitted so far has completed, for
+        // objects replaced between frames. Releasing it is what destroys it.
+        void retire(std::shared_ptr<void> resource);
 
         VkCommandBuffer beginFrame();
         void endFrame();
-        void beginSwapChainRenderPass(VkCommandBuffer commandBuffer);
+        void beginSwapChainRenderPass(
+                VkCommandBuffer commandBuffer,
+                VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
         void endSwapChainRenderPass(VkCommandBuffer commandBuffer);
-        
+
+        // Returns a secondary command buffer that continues the swap chain render pass.
+        // Each worker index may only be used by one thread at a time within a frame.
+        VkCommandBuffer beginSecondaryCommandBuffer(uint32_t workerIndex);
+        void endSecondaryCommandBuffer(VkCommandBuffer commandBuffer);
+        void executeSecondaryCommandBuffers(
+                VkCommandBuffer commandBuffer,
+                const std::vector<VkCommandBuffer> &secondaryCommandBuffers);
+
 
     private:
-        void createCommandBuffers();
-        void freeCommandBuffers();
+        void createFrameContexts();
+        void setViewportAndScissor(VkCommandBuffer commandBuffer);
         void recreateSwapChain();
+        void destroyIdleResources();
+        void createTimestampQueries();
+        void readTimestamps(size_t frameIndex);
+        void collectLatency(size_t frameIndex, std::chrono::steady_clock::time_point now);
 
     private:
-        ChronosWindow& chronosWindow;
+        ChronosWindow *chronosWindow = nullptr;
         ChronosDevice& chronosDevice;
+        // exactly one of these exists; renderTarget points at it
         std::unique_ptr<ChronosSwapChain> chronosSwapChain;
-        std::vector<VkCommandBuffer> commandBuffers;
+        std::unique_ptr<ChronosOffscreenTarget> offscreenTarget;
+        ChronosRenderTarget *renderTarget = nullptr;
+        std::vector<std::unique_ptr<ChronosFrameContext>> frameContexts;
+        uint32_t workerCount;
+        ChronosPresentConfig presentConfig;
+        uint64_t submittedFrames = 0;
+
+        // Replaced swap chains and other objects that earlier frames may still be using.
+        // Each is released once the fence of its last submission has been waited on.
+        struct RetiredResource {
+            std::shared_ptr<void> resource;
+            uint64_t idleFromFrame;
+        };
+        std::vector<RetiredResource> retiredResources;
+        bool presentModeChanged = false;
+
+        // input sample time of each slot's pending submission, zero once collected
+        std::vector<std::chrono::steady_clock::time_point> frameInputTimes;
+        std::chrono::steady_clock::time_point inputTime{};
+        bool inputSampled = false;
+        LatencyStats latencyStats{};
+
+        // two timestamps per frame slot
+        VkQueryPool timestampPool = VK_NULL_HANDLE;
+        std::vector<bool> frameTimestamped;
+        double gpuMilliseconds = -1.0;
 
+        VkCommandBuffer currentCommandBuffer = VK_NULL_HANDLE;
         uint32_t currentImageIndex;
-        bool isFrameStarted;
+        size_t currentFrameIndex = 0;
+        bool isFrameStarted = false;
     };
 }
@@ -0,0 +1,163 @@
+#include "chronos_shader_library.hpp"
+#include "chronos_pipeline.hpp"
+
+//std
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define CHRONOS_HAS_MMAP 1
+#endif
+
+namespace Chronos {
+
+    namespace {
+        constexpr uint32_t SPIRV_MAGIC = 0x07230203;
+
+        // Read-only view of a whole file. Falls back to reading into memory where
+        // mmap is unavailable.
+        class MappedFile {
+        public:
+            explicit MappedFile(const std::string &filepath)
+            {
+#ifdef CHRONOS_HAS_MMAP
+                int fd = open(filepath.c_str(), O_RDONLY);
+                if (fd < 0) {
+                    throw std::runtime_error("failed to open file: " + filepath);
+                }
+                struct stat info{};
+                if (fstat(fd, &info) != 0) {
+                    close(fd);
+                    throw std::runtime_error("failed to stat file: " + filepath);
+                }
+                size = static_cast<size_t>(info.st_size);
+                if (size > 0) {
+                    mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+                }
+                // the mapping keeps the file referenced
+                close(fd);
+                if (mapping == MAP_FAILED) {
+                    mapping = nullptr;
+                    throw std::runtime_error("failed to map file: " + filepath);
+                }
+                data = static_cast<const char *>(mapping);
+#else
+                fallback = ChronosPipeline::readFile(filepath);
+                data = fallback.data();
+                size = fallback.size();
+#endif
+            }
+
+            ~MappedFile()
+            {
+#ifdef CHRONOS_HAS_MMAP
+                if (mapping) {
+                    munmap(mapping, size);
+                }
+#endif
+            }
+
+            MappedFile(const MappedFile &) = delete;
+            MappedFile &operator=(const MappedFile &) = delete;
+
+            // page aligned when mapped, so SPIR-V words can be read in place
+            const char *data = nullptr;
+            size_t size = 0;
+
+        private:
+#ifdef CHRONOS_HAS_MMAP
+            void *mapping = nullptr;
+#else
+            std::vector<char> fallback;
+#endif
+        };
+
+        // FNV-1a
+        uint64_t hashContent(const char *data, size_t size)
+        {
+            uint64_t hash = 14695981039346656037ull;
+            for (size_t i = 0; i < size; i++) {
+                hash ^= static_cast<uint8_t>(data[i]);
+                hash *= 1099511628211ull;
+            }
+            return hash;
+        }
+    }
+
+    ChronosShaderModule::ChronosShaderModule(
+            ChronosDevice &device,
+            const uint32_t *code,
+            size_t codeSize,
+            uint64_t contentHash)
+        : chronosDevice{device},
+          contentHash{contentHash},
+          reflection{reflectSpirv(code, codeSize / sizeof(uint32_t))},
+          spirv{code, code + codeSize / sizeof(uint32_t)}
+    {
+        VkShaderModuleCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        createInfo.codeSize = codeSize;
+        createInfo.pCode = code;
+
+        if (vkCreateShaderModule(chronosDevice.device(), &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create shader module!");
+        }
+    }
+
+    ChronosShaderModule::~ChronosShaderModule()
+    {
+        vkDestroyShaderModule(chronosDevice.device(), shaderModule, nullptr);
+    }
+
+    bool ChronosShaderModule::hasCode(const char *data, size_t size) const
+    {
+        return size == spirv.size() * sizeof(uint32_t) && std::memcmp(data, spirv.data(), size) == 0;
+    }
+
+    ChronosShaderLibrary::ChronosShaderLibrary(ChronosDevice &device) : chronosDevice{device} {}
+
+    std::shared_ptr<ChronosShaderModule> ChronosShaderLibrary::loadModule(const std::string &filepath)
+    {
+        MappedFile file{filepath};
+        if (file.size < sizeof(uint32_t) || file.size % sizeof(uint32_t) != 0 ||
+            *reinterpret_cast<const uint32_t *>(file.data) != SPIRV_MAGIC) {
+            throw std::runtime_error("not a SPIR-V module: " + filepath);
+        }
+        ContentKey key{hashContent(file.data, file.size), file.size};
+
+        std::lock_guard<std::mutex> lock{mutex};
+        stats.filesLoaded++;
+        stats.bytesLoaded += file.size;
+        auto &entry = modules[key];
+        auto cached = entry.lock();
+        if (cached && cached->hasCode(file.data, file.size)) {
+            stats.modulesShared++;
+            return cached;
+        }
+
+        auto module = std::make_shared<ChronosShaderModule>(
+                chronosDevice, reinterpret_cast<const uint32_t *>(file.data), file.size, key.hash);
+        // on a hash collision the live module keeps the entry and this one goes unshared
+        if (!cached) {
+            entry = module;
+        }
+        stats.modulesCreated++;
+
+        // drop entries whose modules are gone so the map does not grow with reloads
+        for (auto it = modules.begin(); it != modules.end();) {
+            it = it->second.expired() ? modules.erase(it) : std::next(it);
+        }
+        return module;
+    }
+
+    ChronosShaderLibrary::Stats ChronosShaderLibrary::getStats()
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        return stats;
+    }
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "chronos_device.hpp"
+#include "chronos_shader_reflection.hpp"
+
+//std
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Chronos {
+
+    class ChronosShaderModule {
+    public:
+        ChronosShaderModule(ChronosDevice &device, const uint32_t *code, size_t codeSize, uint64_t contentHash);
+        ~ChronosShaderModule();
+
+        ChronosShaderModule(const ChronosShaderModule &) = delete;
+        ChronosShaderModule &operator=(const ChronosShaderModule &) = delete;
+
+        VkShaderModule getModule() const { return shaderModule; }
+        uint64_t getContentHash() const { return contentHash; }
+        const ChronosShaderReflection &getReflection() const { return reflection; }
+        // true if the module was created from exactly these bytes
+        bool hasCode(const char *data, size_t size) const;
+
+    private:
+        ChronosDevice &chronosDevice;
+        VkShaderModule shaderModule;
+        uint64_t contentHash;
+        ChronosShaderReflection reflection;
+        // kept so a hash match can be confirmed before the module is shared
+        std::vector<uint32_t> spirv;
+    };
+
+    // Loads SPIR-V by memory-mapping the file, so the bytes go straight from the
+    // page cache to the driver. Modules are shared by content: two paths holding
+    // identical SPIR-V, or two pipelines built at once from the same file, get the
+    // same VkShaderModule; a hash match is compared byte for byte before sharing.
+    // The library only keeps weak references, so a module is destroyed as soon as
+    // the pipelines using it are built. Thread-safe.
+    class ChronosShaderLibrary {
+    public:
+        struct Stats {
+            uint64_t filesLoaded = 0;
+            uint64_t bytesLoaded = 0;
+            uint64_t modulesCreated = 0;
+            uint64_t modulesShared = 0;
+        };
+
+        explicit ChronosShaderLibrary(ChronosDevice &device);
+
+        ChronosShaderLibrary(const ChronosShaderLibrary &) = delete;
+        ChronosShaderLibrary &operator=(const ChronosShaderLibrary &) = delete;
+
+        // Throws if the file cannot be read, is not SPIR-V or cannot be reflected.
+        std::shared_ptr<ChronosShaderModule> loadModule(const std::string &filepath);
+
+        Stats getStats();
+
+    private:
+        struct ContentKey {
+            uint64_t hash;
+            size_t size;
+
+            bool operator==(const ContentKey &other) const { return hash == other.hash && size == other.size; }
+        };
+
+        struct ContentKeyHash {
+            size_t operator()(const ContentKey &key) const { return static_cast<size_t>(key.hash); }
+        };
+
+        ChronosDevice &chronosDevice;
+
+        std::mutex mutex;
+        std::unordered_map<ContentKey, std::weak_ptr<ChronosShaderModule>, ContentKeyHash> modules;
+        Stats stats;
+    };
+}
@@ -0,0 +1,426 @@
+#include "chronos_shader_reflection.hpp"
+
+//std
+#include <algorithm>
+#include <stdexcept>
+
+namespace Chronos {
+
+    namespace {
+        constexpr uint32_t SPIRV_MAGIC = 0x07230203;
+        constexpr uint32_t SPIRV_HEADER_WORDS = 5;
+        constexpr uint32_t NONE = UINT32_MAX;
+
+        enum Op : uint32_t {
+            OpEntryPoint = 15,
+            OpTypeInt = 21,
+            OpTypeFloat = 22,
+            OpTypeVector = 23,
+            OpTypeMatrix = 24,
+            OpTypeImage = 25,
+            OpTypeSampler = 26,
+            OpTypeSampledImage = 27,
+            OpTypeArray = 28,
+            OpTypeRuntimeArray = 29,
+            OpTypeStruct = 30,
+            OpTypePointer = 32,
+            OpConstant = 43,
+            OpVariable = 59,
+            OpDecorate = 71,
+            OpMemberDecorate = 72,
+        };
+
+        enum Decoration : uint32_t {
+            DecorationBufferBlock = 3,
+            DecorationArrayStride = 6,
+            DecorationMatrixStride = 7,
+            DecorationBuiltIn = 11,
+            DecorationLocation = 30,
+            DecorationBinding = 33,
+            DecorationDescriptorSet = 34,
+            DecorationOffset = 35,
+        };
+
+        enum StorageClass : uint32_t {
+            StorageUniformConstant = 0,
+            StorageInput = 1,
+            StorageUniform = 2,
+            StoragePushConstant = 9,
+            StorageStorageBuffer = 12,
+        };
+
+        enum ExecutionModel : uint32_t {
+            ExecutionVertex = 0,
+            ExecutionTessellationControl = 1,
+            ExecutionTessellationEvaluation = 2,
+            ExecutionGeometry = 3,
+            ExecutionFragment = 4,
+            ExecutionGLCompute = 5,
+        };
+
+        enum ImageDim : uint32_t {
+            DimBuffer = 5,
+            DimSubpassData = 6,
+        };
+
+        // an id's defining instruction plus the decorations the reflection cares about
+        struct Id {
+            uint32_t opcode = 0;
+            // words after the opcode word
+            std::vector<uint32_t> operands;
+            uint32_t location = NONE;
+            uint32_t binding = NONE;
+            uint32_t set = NONE;
+            uint32_t arrayStride = 0;
+            bool builtIn = false;
+            bool bufferBlock = false;
+            std::vector<uint32_t> memberOffsets;
+            std::vector<uint32_t> memberMatrixStrides;
+        };
+
+        struct TypeLayout {
+            uint32_t size;
+            uint32_t alignment;
+        };
+
+        class Module {
+        public:
+            Module(const uint32_t *code, size_t wordCount)
+            {
+                if (wordCount < SPIRV_HEADER_WORDS || code[0] != SPIRV_MAGIC) {
+                    throw std::runtime_error("not a SPIR-V module!");
+                }
+                ids.resize(code[3]);
+
+                for (size_t i = SPIRV_HEADER_WORDS; i < wordCount;) {
+                    uint32_t opcode = code[i] & 0xffff;
+                    uint32_t length = code[i] >> 16;
+                    if (length == 0 || i + length > wordCount) {
+                        throw std::runtime_error("truncated SPIR-V instruction!");
+                    }
+                    parseInstruction(opcode, code + i + 1, length - 1);
+                    i += length;
+                }
+                if (!hasEntryPoint) {
+                    throw std::runtime_error("SPIR-V module has no entry point!");
+                }
+            }
+
+            const Id &id(uint32_t index) const
+            {
+                if (index >= ids.size()) {
+                    throw std::runtime_error("SPIR-V id out of range!");
+                }
+                return ids[index];
+            }
+
+            // the type a variable of pointer type points to
+            const Id &pointee(const Id &variable) const { return id(id(variable.operands[0]).operands[2]); }
+
+            uint32_t constantValue(uint32_t constantId) const
+            {
+                const Id &constant = id(constantId);
+                if (constant.opcode != OpConstant) {
+                    throw std::runtime_error("specialization-sized arrays are not supported!");
+                }
+                return constant.operands[2];
+            }
+
+            TypeLayout layoutOf(const Id &type, uint32_t matrixStride = 0) const
+            {
+                switch (type.opcode) {
+                    case OpTypeInt:
+                    case OpTypeFloat:
+                        return {type.operands[1] / 8, type.operands[1] / 8};
+                    case OpTypeVector: {
+                        TypeLayout component = layoutOf(id(type.operands[1]));
+                        uint32_t count = type.operands[2];
+                        return {component.size * count, component.size * (count == 3 ? 4 : count)};
+                    }
+                    case OpTypeMatrix: {
+                        TypeLayout column = layoutOf(id(type.operands[1]));
+                        uint32_t stride = matrixStride ? matrixStride : column.alignment;
+                        return {stride * type.operands[2], column.alignment};
+                    }
+                    case OpTypeArray: {
+                        TypeLayout element = layoutOf(id(type.operands[1]), matrixStride);
+                        uint32_t stride = type.arrayStride ? type.arrayStride : element.size;
+                        return {stride * constantValue(type.operands[2]), element.alignment};
+                    }
+                    case OpTypeStruct: {
+                        TypeLayout layout{0, 1};
+                        for (size_t member = 1; member < type.operands.size(); member++) {
+                            size_t index = member - 1;
+                            uint32_t offset = index < type.memberOffsets.size() ? type.memberOffsets[index] : NONE;
+                            if (offset == NONE) {
+                                throw std::runtime_error("SPIR-V block member has no offset!");
+                            }
+                            uint32_t memberMatrixStride =
+                                    index < type.memberMatrixStrides.size() ? type.memberMatrixStrides[index] : 0;
+                            TypeLayout memberLayout = layoutOf(id(type.operands[member]), memberMatrixStride);
+                            layout.size = std::max(layout.size, offset + memberLayout.size);
+                            layout.alignment = std::max(layout.alignment, memberLayout.alignment);
+                        }
+                        layout.size = (layout.size + layout.alignment - 1) / layout.alignment * layout.alignment;
+                        return layout;
+                    }
+                    default:
+                        throw std::runtime_error("unsupported type in SPIR-V block!");
+                }
+            }
+
+            std::vector<Id> ids;
+            uint32_t executionModel = 0;
+            bool hasEntryPoint = false;
+            std::vector<uint32_t> variables;
+
+        private:
+            void parseInstruction(uint32_t opcode, const uint32_t *operands, uint32_t count)
+            {
+                switch (opcode) {
+                    case OpEntryPoint:
+                        if (!hasEntryPoint && count >= 1) {
+                            executionModel = operands[0];
+                            hasEntryPoint = true;
+                        }
+                        break;
+                    case OpDecorate:
+                        if (count >= 2) {
+                            decorate(at(operands[0]), operands[1], count >= 3 ? operands[2] : 0);
+                        }
+                        break;
+                    case OpMemberDecorate:
+                        if (count >= 4) {
+                            decorateMember(at(operands[0]), operands[1], operands[2], operands[3]);
+                        }
+                        break;
+                    case OpTypeInt:
+                    case OpTypeFloat:
+                    case OpTypeVector:
+                    case OpTypeMatrix:
+                    case OpTypeImage:
+                    case OpTypeSampler:
+                    case OpTypeSampledImage:
+                    case OpTypeArray:
+                    case OpTypeRuntimeArray:
+                    case OpTypeStruct:
+                    case OpTypePointer:
+                        if (count >= 1) {
+                            define(at(operands[0]), opcode, operands, count);
+                        }
+                        break;
+                    case OpConstant:
+                    case OpVariable:
+                        if (count >= 3) {
+                            define(at(operands[1]), opcode, operands, count);
+                            if (opcode == OpVariable) {
+                                variables.push_back(operands[1]);
+                            }
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            }
+
+            Id &at(uint32_t index)
+            {
+                if (index >= ids.size()) {
+                    throw std::runtime_error("SPIR-V id out of range!");
+                }
+                return ids[index];
+            }
+
+            static void define(Id &target, uint32_t opcode, const uint32_t *operands, uint32_t count)
+            {
+                target.opcode = opcode;
+                target.operands.assign(operands, operands + count);
+            }
+
+            static void decorate(Id &target, uint32_t decoration, uint32_t value)
+            {
+                switch (decoration) {
+                    case DecorationLocation: target.location = value; break;
+                    case DecorationBinding: target.binding = value; break;
+                    case DecorationDescriptorSet: target.set = value; break;
+                    case DecorationArrayStride: target.arrayStride = value; break;
+                    case DecorationBuiltIn: target.builtIn = true; break;
+                    case DecorationBufferBlock: target.bufferBlock = true; break;
+                    default: break;
+                }
+            }
+
+            static void decorateMember(Id &target, uint32_t member, uint32_t decoration, uint32_t value)
+            {
+                if (decoration == DecorationOffset) {
+                    if (target.memberOffsets.size() <= member) target.memberOffsets.resize(member + 1, NONE);
+                    target.memberOffsets[member] = value;
+                } else if (decoration == DecorationMatrixStride) {
+                    if (target.memberMatrixStrides.size() <= member) target.memberMatrixStrides.resize(member + 1, 0);
+                    target.memberMatrixStrides[member] = value;
+                }
+            }
+        };
+
+        VkShaderStageFlagBits stageOf(uint32_t executionModel)
+        {
+            switch (executionModel) {
+                case ExecutionVertex: return VK_SHADER_STAGE_VERTEX_BIT;
+                case ExecutionTessellationControl: return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+                case ExecutionTessellationEvaluation: return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+                case ExecutionGeometry: return VK_SHADER_STAGE_GEOMETRY_BIT;
+                case ExecutionFragment: return VK_SHADER_STAGE_FRAGMENT_BIT;
+                case ExecutionGLCompute: return VK_SHADER_STAGE_COMPUTE_BIT;
+                default: throw std::runtime_error("unsupported SPIR-V execution model!");
+            }
+        }
+
+        VkFormat vertexFormatOf(const Module &module, const Id &type)
+        {
+            const Id &component = type.opcode == OpTypeVector ? module.id(type.operands[1]) : type;
+            uint32_t count = type.opcode == OpTypeVector ? type.operands[2] : 1;
+            if ((component.opcode != OpTypeFloat && component.opcode != OpTypeInt) || component.operands[1] != 32) {
+                throw std::runtime_error("unsupported vertex input type!");
+            }
+
+            static const VkFormat floatFormats[] = {
+                VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT};
+            static const VkFormat intFormats[] = {
+                VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT};
+            static const VkFormat uintFormats[] = {
+                VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT};
+            if (component.opcode == OpTypeFloat) return floatFormats[count - 1];
+            return component.operands[2] ? intFormats[count - 1] : uintFormats[count - 1];
+        }
+
+        VkDescriptorType descriptorTypeOf(const Id &type, uint32_t storageClass)
+        {
+            if (storageClass == StorageStorageBuffer) {
+                return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            }
+            if (storageClass == StorageUniform) {
+                return type.bufferBlock ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+            }
+            switch (type.opcode) {
+                case OpTypeSampler:
+                    return VK_DESCRIPTOR_TYPE_SAMPLER;
+                case OpTypeSampledImage:
+                    return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+                case OpTypeImage: {
+                    // operands: result, sampled type, dim, depth, arrayed, ms, sampled
+                    uint32_t dim = type.operands[2];
+                    bool storage = type.operands[6] == 2;
+                    if (dim == DimSubpassData) return VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+                    if (dim == DimBuffer) {
+                        return storage ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+                    }
+                    return storage ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+                }
+                default:
+                    throw std::runtime_error("unsupported descriptor type in SPIR-V!");
+            }
+        }
+
+        enum class NumericType { Float, SignedInt, UnsignedInt, Other };
+
+        NumericType numericTypeOf(VkFormat format)
+        {
+            switch (format) {
+                case VK_FORMAT_R32_SFLOAT:
+                case VK_FORMAT_R32G32_SFLOAT:
+                case VK_FORMAT_R32G32B32_SFLOAT:
+                case VK_FORMAT_R32G32B32A32_SFLOAT:
+                case VK_FORMAT_R8G8B8A8_UNORM:
+                    return NumericType::Float;
+                case VK_FORMAT_R32_SINT:
+                case VK_FORMAT_R32G32_SINT:
+                case VK_FORMAT_R32G32B32_SINT:
+                case VK_FORMAT_R32G32B32A32_SINT:
+                    return NumericType::SignedInt;
+                case VK_FORMAT_R32_UINT:
+                case VK_FORMAT_R32G32_UINT:
+                case VK_FORMAT_R32G32B32_UINT:
+                case VK_FORMAT_R32G32B32A32_UINT:
+                    return NumericType::UnsignedInt;
+                default:
+                    return NumericType::Other;
+            }
+        }
+    }
+
+    ChronosShaderReflection reflectSpirv(const uint32_t *code, size_t wordCount)
+    {
+        Module module{code, wordCount};
+        ChronosShaderReflection reflection{};
+        reflection.stage = stageOf(module.executionModel);
+
+        for (uint32_t variableId : module.variables) {
+            const Id &variable = module.id(variableId);
+            uint32_t storageClass = variable.operands[2];
+            const Id &type = module.pointee(variable);
+
+            if (storageClass == StorageInput) {
+                if (reflection.stage != VK_SHADER_STAGE_VERTEX_BIT || variable.builtIn ||
+                    variable.location == NONE || type.opcode == OpTypeStruct) {
+                    continue;
+                }
+                if (type.opcode == OpTypeMatrix) {
+                    VkFormat columnFormat = vertexFormatOf(module, module.id(type.operands[1]));
+                    for (uint32_t column = 0; column < type.operands[2]; column++) {
+                        reflection.vertexInputs.push_back({variable.location + column, columnFormat});
+                    }
+                } else {
+                    reflection.vertexInputs.push_back({variable.location, vertexFormatOf(module, type)});
+                }
+            } else if (storageClass == StoragePushConstant) {
+                reflection.pushConstantSize = std::max(reflection.pushConstantSize, module.layoutOf(type).size);
+            } else if (storageClass == StorageUniformConstant || storageClass == StorageUniform ||
+                       storageClass == StorageStorageBuffer) {
+                if (variable.binding == NONE) {
+                    continue;
+                }
+                const Id *element = &type;
+                uint32_t count = 1;
+                if (type.opcode == OpTypeRuntimeArray) {
+                    throw std::runtime_error("unsized descriptor arrays are not supported!");
+                }
+                if (type.opcode == OpTypeArray) {
+                    count = module.constantValue(type.operands[2]);
+                    element = &module.id(type.operands[1]);
+                }
+                reflection.descriptorBindings.push_back({
+                        variable.set == NONE ? 0 : variable.set,
+                        variable.binding,
+                        descriptorTypeOf(*element, storageClass),
+                        count});
+            }
+        }
+
+        std::sort(reflection.vertexInputs.begin(), reflection.vertexInputs.end(), [](const auto &a, const auto &b) {
+            return a.location < b.location;
+        });
+        return reflection;
+    }
+
+    void validateVertexInputs(
+            const ChronosShaderReflection &reflection,
+            const std::vector<VkVertexInputAttributeDescription> &attributes,
+            const std::string &shaderName)
+    {
+        for (const auto &input : reflection.vertexInputs) {
+            auto attribute = std::find_if(attributes.begin(), attributes.end(), [&](const auto &candidate) {
+                return candidate.location == input.location;
+            });
+            if (attribute == attributes.end()) {
+                throw std::runtime_error(
+                        shaderName + ": no vertex attribute for input location " + std::to_string(input.location) + "!");
+            }
+            NumericType provided = numericTypeOf(attribute->format);
+            if (provided != NumericType::Other && provided != numericTypeOf(input.format)) {
+                throw std::runtime_error(
+                        shaderName + ": vertex attribute at location " + std::to_string(input.location) +
+                        " does not match the input's numeric type!");
+            }
+        }
+    }
+}
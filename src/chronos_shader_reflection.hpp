@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+//std
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Chronos {
+
+    // What a SPIR-V module needs from its pipeline layout and vertex input state.
+    // Only the first entry point is looked at.
+    struct ChronosShaderReflection {
+        struct VertexInput {
+            uint32_t location;
+            VkFormat format;
+        };
+
+        struct DescriptorBinding {
+            uint32_t set;
+            uint32_t binding;
+            VkDescriptorType type;
+            uint32_t count;
+        };
+
+        VkShaderStageFlagBits stage = VK_SHADER_STAGE_VERTEX_BIT;
+        // vertex stage only, sorted by location; a matrix takes one location per column
+        std::vector<VertexInput> vertexInputs;
+        std::vector<DescriptorBinding> descriptorBindings;
+        // size of the push constant block, padded to its alignment; zero without one
+        uint32_t pushConstantSize = 0;
+    };
+
+    // Throws if the module is malformed or uses something the engine has no layout for.
+    ChronosShaderReflection reflectSpirv(const uint32_t *code, size_t wordCount);
+
+    // Checks that every input of the vertex shader is fed by an attribute of the
+    // same numeric type. Throws naming shaderName otherwise.
+    void validateVertexInputs(
+            const ChronosShaderReflection &reflection,
+            const std::vector<VkVertexInputAttributeDescription> &attributes,
+            const std::string &shaderName);
+}
@@ -0,0 +1,176 @@
+#include "chronos_shader_watcher.hpp"
+#include "chronos_utils.hpp"
+
+//std
+#include <cerrno>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <set>
+#include <system_error>
+#include <vector>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <spawn.h>
+#include <sys/wait.h>
+extern char **environ;
+#elif defined(_WIN32)
+#include <process.h>
+#endif
+
+namespace Chronos {
+
+    namespace {
+        bool isShaderSource(const std::string &name)
+        {
+            for (const char *extension : {".vert", ".frag", ".comp"}) {
+                std::string suffix{extension};
+                if (name.size() > suffix.size() &&
+                    name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // Runs the program found on PATH with the given arguments, without a shell, and
+        // waits for it. True if it exited with status 0.
+        bool runProcess(const std::vector<std::string> &args)
+        {
+            std::vector<char *> argv;
+            for (const auto &arg : args) {
+                argv.push_back(const_cast<char *>(arg.c_str()));
+            }
+            argv.push_back(nullptr);
+#if defined(__unix__) || defined(__APPLE__)
+            pid_t pid;
+            if (posix_spawnp(&pid, argv[0], nullptr, nullptr, argv.data(), environ) != 0) {
+                return false;
+            }
+            int status = 0;
+            while (waitpid(pid, &status, 0) < 0) {
+                if (errno != EINTR) {
+                    return false;
+                }
+            }
+            return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+#elif defined(_WIN32)
+            return _spawnvp(_P_WAIT, argv[0], argv.data()) == 0;
+#else
+            return false;
+#endif
+        }
+    }
+
+    std::string ChronosShaderWatcher::defaultCompiler()
+    {
+        if (const char *sdk = std::getenv("VULKAN_SDK")) {
+            return std::string{sdk} + "/bin/glslc";
+        }
+        return "glslc";
+    }
+
+    ChronosShaderWatcher::ChronosShaderWatcher(const std::string &shaderDirectory, std::string compiler)
+        : shaderDirectory{shaderDirectory}, compiler{std::move(compiler)}
+    {
+        if (!this->shaderDirectory.empty() && this->shaderDirectory.back() != '/') {
+            this->shaderDirectory += '/';
+        }
+#ifdef __linux__
+        inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (inotifyFd < 0) {
+            std::cerr << "failed to start shader watcher" << std::endl;
+            return;
+        }
+        // editors either write in place or rename a temporary over the file
+        if (inotify_add_watch(inotifyFd, this->shaderDirectory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+            std::cerr << "failed to watch shader directory: " << this->shaderDirectory << std::endl;
+            close(inotifyFd);
+            inotifyFd = -1;
+            return;
+        }
+        running = true;
+        watchThread = std::thread{&ChronosShaderWatcher::watchLoop, this};
+#endif
+    }
+
+    ChronosShaderWatcher::~ChronosShaderWatcher()
+    {
+        running = false;
+        if (watchThread.joinable()) {
+            watchThread.join();
+        }
+#ifdef __linux__
+        if (inotifyFd >= 0) {
+            close(inotifyFd);
+        }
+#endif
+    }
+
+    std::vector<std::string> ChronosShaderWatcher::takeCompiledShaders()
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        return std::move(compiledShaders);
+    }
+
+    void ChronosShaderWatcher::watchLoop()
+    {
+#ifdef __linux__
+        alignas(inotify_event) char buffer[4096];
+        while (running) {
+            // wakes up regularly to notice shutdown
+            pollfd descriptor{inotifyFd, POLLIN, 0};
+            if (poll(&descriptor, 1, 100) <= 0) {
+                continue;
+            }
+
+            // one save can raise several events; compile each source once per batch
+            std::set<std::string> changed;
+            ssize_t length;
+            while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+                for (char *event = buffer; event < buffer + length;) {
+                    auto *info = reinterpret_cast<inotify_event *>(event);
+                    if (info->len > 0 && isShaderSource(info->name)) {
+                        changed.insert(info->name);
+                    }
+                    event += sizeof(inotify_event) + info->len;
+                }
+            }
+
+            for (const auto &sourceName : changed) {
+                if (compile(sourceName)) {
+                    std::lock_guard<std::mutex> lock{mutex};
+                    compiledShaders.push_back(shaderDirectory + sourceName + ".spv");
+                }
+            }
+        }
+#endif
+    }
+
+    bool ChronosShaderWatcher::compile(const std::string &sourceName)
+    {
+        std::string source = shaderDirectory + sourceName;
+        std::string output = source + ".spv";
+        // written aside and renamed over, so a reader never maps a partial module
+        std::string tempOutput = output + ".tmp";
+
+        if (!runProcess({compiler, source, "-o", tempOutput})) {
+            std::cerr << "failed to compile shader: " << source << std::endl;
+            std::error_code ignored;
+            std::filesystem::remove(tempOutput, ignored);
+            return false;
+        }
+        if (std::error_code error = replaceFile(tempOutput, output)) {
+            std::cerr << "failed to replace shader: " << output << " (" << error.message() << ")" << std::endl;
+            return false;
+        }
+        std::cout << "Recompiled shader: " << sourceName << std::endl;
+        return true;
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+//std
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Chronos {
+
+    // Watches a directory of GLSL sources (.vert, .frag, .comp) and recompiles
+    // each one that changes to <name>.spv in the same directory, like
+    // build_shaders.sh. Compiling runs on the watcher's thread; the results are
+    // picked up at a frame boundary with takeCompiledShaders(). A source that
+    // fails to compile leaves its previous .spv in place.
+    //
+    // Uses inotify, so it only watches on Linux; elsewhere isWatching() is false.
+    class ChronosShaderWatcher {
+    public:
+        // glslc from $VULKAN_SDK/bin when set, otherwise from PATH
+        static std::string defaultCompiler();
+
+        explicit ChronosShaderWatcher(const std::string &shaderDirectory, std::string compiler = defaultCompiler());
+        ~ChronosShaderWatcher();
+
+        ChronosShaderWatcher(const ChronosShaderWatcher &) = delete;
+        ChronosShaderWatcher &operator=(const ChronosShaderWatcher &) = delete;
+
+        bool isWatching() const { return watchThread.joinable(); }
+
+        // Paths of the .spv files rewritten since the last call.
+        std::vector<std::string> takeCompiledShaders();
+
+    private:
+        void watchLoop();
+        bool compile(const std::string &sourceName);
+
+        std::string shaderDirectory;
+        std::string compiler;
+        int inotifyFd = -1;
+
+        std::mutex mutex;
+        std::vector<std::string> compiledShaders;
+        std::atomic<bool> running{false};
+        std::thread watchThread;
+    };
+}
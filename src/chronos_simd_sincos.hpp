@@ -0,0 +1,55 @@
+#pragma once
+
+// Shared by the per-ISA transform kernels. Each translation unit supplies an Ops
+// struct wrapping its intrinsics, so every instantiation is distinct.
+
+namespace Chronos {
+
+    // Cephes sinf/cosf: reduce to [-pi/4, pi/4] by octant, evaluate both minimax
+    // polynomials and swap/negate per octant.
+    template <typename Ops>
+    inline void simdSinCos(typename Ops::F x, typename Ops::F &outSin, typename Ops::F &outCos)
+    {
+        using F = typename Ops::F;
+        using I = typename Ops::I;
+
+        const F signMask = Ops::castToFloat(Ops::set1i(static_cast<int>(0x80000000u)));
+        F sinSign = Ops::andBits(x, signMask);
+        x = Ops::andNotBits(signMask, x);
+
+        // octant, rounded up to even
+        I octant = Ops::truncateToInt(Ops::mul(x, Ops::set1(1.27323954473516f)));
+        octant = Ops::andi(Ops::addi(octant, Ops::set1i(1)), Ops::set1i(~1));
+        F y = Ops::toFloat(octant);
+
+        F sinSwap = Ops::castToFloat(Ops::shiftLeft29(Ops::andi(octant, Ops::set1i(4))));
+        F cosSign = Ops::castToFloat(
+                Ops::shiftLeft29(Ops::andNoti(Ops::subi(octant, Ops::set1i(2)), Ops::set1i(4))));
+        F polyMask = Ops::castToFloat(Ops::equali(Ops::andi(octant, Ops::set1i(2)), Ops::set1i(0)));
+        sinSign = Ops::xorBits(sinSign, sinSwap);
+
+        // extended precision modular arithmetic: x - y * pi/4
+        x = Ops::mulAdd(y, Ops::set1(-0.78515625f), x);
+        x = Ops::mulAdd(y, Ops::set1(-2.4187564849853515625e-4f), x);
+        x = Ops::mulAdd(y, Ops::set1(-3.77489497744594108e-8f), x);
+
+        F z = Ops::mul(x, x);
+
+        F cosPoly = Ops::set1(2.443315711809948e-5f);
+        cosPoly = Ops::mulAdd(cosPoly, z, Ops::set1(-1.388731625493765e-3f));
+        cosPoly = Ops::mulAdd(cosPoly, z, Ops::set1(4.166664568298827e-2f));
+        cosPoly = Ops::mul(Ops::mul(cosPoly, z), z);
+        cosPoly = Ops::mulAdd(z, Ops::set1(-0.5f), cosPoly);
+        cosPoly = Ops::add(cosPoly, Ops::set1(1.f));
+
+        F sinPoly = Ops::set1(-1.9515295891e-4f);
+        sinPoly = Ops::mulAdd(sinPoly, z, Ops::set1(8.3321608736e-3f));
+        sinPoly = Ops::mulAdd(sinPoly, z, Ops::set1(-1.6666654611e-1f));
+        sinPoly = Ops::mulAdd(Ops::mul(sinPoly, z), x, x);
+
+        F sinValue = Ops::orBits(Ops::andBits(polyMask, sinPoly), Ops::andNotBits(polyMask, cosPoly));
+        F cosValue = Ops::orBits(Ops::andBits(polyMask, cosPoly), Ops::andNotBits(polyMask, sinPoly));
+        outSin = Ops::xorBits(sinValue, sinSign);
+        outCos = Ops::xorBits(cosValue, cosSign);
+    }
+}
@@ -0,0 +1,450 @@
+#include "chronos_staging_ring.hpp"
+#include "chronos_device.hpp"
+
+//std
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace Chronos {
+
+    namespace {
+        VkImageSubresourceRange colorSubresourceRange(uint32_t layerCount)
+        {
+            VkImageSubresourceRange range{};
+            range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            range.baseMipLevel = 0;
+            range.levelCount = 1;
+            range.baseArrayLayer = 0;
+            range.layerCount = layerCount;
+            return range;
+        }
+    }
+
+    ChronosStagingRing::ChronosStagingRing(ChronosDevice &device, VkDeviceSize capacity)
+        : chronosDevice{device}, capacity{capacity}
+    {
+        QueueFamilyIndices indices = chronosDevice.findPhysicalQueueFamilies();
+        ownershipTransfer = indices.hasDedicatedTransfer();
+        transferFamily = indices.transferFamily;
+        graphicsFamily = indices.graphicsFamily;
+
+        chronosDevice.createBuffer(
+                capacity,
+                VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                ringBuffer,
+                ringAllocation);
+
+        VkCommandPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.queueFamilyIndex = transferFamily;
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+        if (vkCreateCommandPool(chronosDevice.device(), &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create staging command pool!");
+        }
+    }
+
+    ChronosStagingRing::~ChronosStagingRing()
+    {
+        waitIdle();
+        for (auto &batch : awaitingAcquire) {
+            vkDestroyFence(chronosDevice.device(), batch.fence, nullptr);
+        }
+        for (auto &batch : freeBatches) {
+            vkDestroyFence(chronosDevice.device(), batch.fence, nullptr);
+        }
+        vkDestroyCommandPool(chronosDevice.device(), commandPool, nullptr);
+        chronosDevice.destroyBuffer(ringBuffer, ringAllocation);
+    }
+
+    ChronosStagingRing::UploadTicket ChronosStagingRing::uploadBuffer(
+            VkBuffer dstBuffer, VkDeviceSize dstOffset, const void *data, VkDeviceSize size)
+    {
+        const char *src = static_cast<const char *>(data);
+
+        // uploads larger than the ring are split into ring-sized chunks
+        while (size > 0) {
+            VkDeviceSize chunkSize = std::min(size, capacity);
+            VkDeviceSize ringOffset = reserve(chunkSize);
+
+            memcpy(static_cast<char *>(ringAllocation.mappedData) + ringOffset, src, static_cast<size_t>(chunkSize));
+
+            VkBufferCopy region{};
+            region.srcOffset = ringOffset;
+            region.dstOffset = dstOffset;
+            region.size = chunkSize;
+            pendingCopies.push_back({dstBuffer, region});
+
+            stats.bytesUploaded += chunkSize;
+            stats.copyCount++;
+
+            src += chunkSize;
+            dstOffset += chunkSize;
+            size -= chunkSize;
+        }
+        return nextTicket;
+    }
+
+    ChronosStagingRing::UploadTicket ChronosStagingRing::uploadImage(
+            VkImage dstImage,
+            uint32_t width,
+            uint32_t height,
+            uint32_t layerCount,
+            const void *data,
+            VkDeviceSize size)
+    {
+        if (size > capacity) {
+            throw std::runtime_error("image upload does not fit in the staging ring!");
+        }
+
+        VkDeviceSize ringOffset = reserve(size);
+        memcpy(static_cast<char *>(ringAllocation.mappedData) + ringOffset, data, static_cast<size_t>(size));
+
+        VkBufferImageCopy region{};
+        region.bufferOffset = ringOffset;
+        region.bufferRowLength = 0;
+        region.bufferImageHeight = 0;
+
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = 0;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = layerCount;
+
+        region.imageOffset = {0, 0, 0};
+        region.imageExtent = {width, height, 1};
+        pendingImageCopies.push_back({dstImage, region});
+
+        stats.bytesUploaded += size;
+        stats.copyCount++;
+        return nextTicket;
+    }
+
+    void ChronosStagingRing::flush()
+    {
+        retireCompletedBatches(false);
+        if (pendingCopies.empty() && pendingImageCopies.empty()) {
+            return;
+        }
+
+        Batch batch = acquireBatch();
+        batch.ticket = nextTicket++;
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer(batch.commandBuffer, &beginInfo);
+
+        // one vkCmdCopyBuffer per run of copies targeting the same buffer
+        std::vector<VkBufferCopy> regions;
+        size_t runStart = 0;
+        for (size_t i = 1; i <= pendingCopies.size(); i++) {
+            if (i == pendingCopies.size() || pendingCopies[i].dstBuffer != pendingCopies[runStart].dstBuffer) {
+                regions.clear();
+                for (size_t j = runStart; j < i; j++) {
+                    regions.push_back(pendingCopies[j].region);
+                }
+                vkCmdCopyBuffer(
+                        batch.commandBuffer,
+                        ringBuffer,
+                        pendingCopies[runStart].dstBuffer,
+                        static_cast<uint32_t>(regions.size()),
+                        regions.data());
+                runStart = i;
+            }
+        }
+
+        if (!pendingImageCopies.empty()) {
+            std::vector<VkImageMemoryBarrier> toTransferDst;
+            for (const auto &copy : pendingImageCopies) {
+                VkImageMemoryBarrier barrier{};
+                barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+                barrier.srcAccessMask = 0;
+                barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+                barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+                barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.image = copy.dstImage;
+                barrier.subresourceRange = colorSubresourceRange(copy.region.imageSubresource.layerCount);
+                toTransferDst.push_back(barrier);
+            }
+            vkCmdPipelineBarrier(
+                    batch.commandBuffer,
+                    VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                    VK_PIPELINE_STAGE_TRANSFER_BIT,
+                    0,
+                    0, nullptr,
+                    0, nullptr,
+                    static_cast<uint32_t>(toTransferDst.size()), toTransferDst.data());
+
+            for (const auto &copy : pendingImageCopies) {
+                vkCmdCopyBufferToImage(
+                        batch.commandBuffer,
+                        ringBuffer,
+                        copy.dstImage,
+                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                        1,
+                        &copy.region);
+            }
+        }
+
+        recordReleaseBarriers(batch);
+
+        if (vkEndCommandBuffer(batch.commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to record staging command buffer!");
+        }
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &batch.commandBuffer;
+
+        if (vkQueueSubmit(chronosDevice.transferQueue(), 1, &submitInfo, batch.fence) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit staging command buffer!");
+        }
+
+        batch.ringEnd = head;
+        lastSubmittedTicket = batch.ticket;
+        inFlightBatches.push_back(std::move(batch));
+        pendingCopies.clear();
+        pendingImageCopies.clear();
+        stats.submitCount++;
+    }
+
+    void ChronosStagingRing::recordReleaseBarriers(Batch &batch)
+    {
+        batch.bufferAcquires.clear();
+        batch.imageAcquires.clear();
+
+        if (!ownershipTransfer) {
+            // same queue: a plain barrier orders the copies before any later draw
+            VkMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+
+            std::vector<VkImageMemoryBarrier> toShaderRead;
+            for (const auto &copy : pendingImageCopies) {
+                VkImageMemoryBarrier imageBarrier{};
+                imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+                imageBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                imageBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+                imageBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+                imageBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+                imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                imageBarrier.image = copy.dstImage;
+                imageBarrier.subresourceRange = colorSubresourceRange(copy.region.imageSubresource.layerCount);
+                toShaderRead.push_back(imageBarrier);
+            }
+
+            vkCmdPipelineBarrier(
+                    batch.commandBuffer,
+                    VK_PIPELINE_STAGE_TRANSFER_BIT,
+                    VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                    0,
+                    1, &barrier,
+                    0, nullptr,
+                    static_cast<uint32_t>(toShaderRead.size()), toShaderRead.data());
+            return;
+        }
+
+        // release half of the queue family ownership transfer; the matching acquire
+        // is recorded on the graphics queue once this batch's fence has signaled
+        std::vector<VkBufferMemoryBarrier> bufferReleases;
+        for (const auto &copy : pendingCopies) {
+            VkBufferMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = 0;
+            barrier.srcQueueFamilyIndex = transferFamily;
+            barrier.dstQueueFamilyIndex = graphicsFamily;
+            barrier.buffer = copy.dstBuffer;
+            barrier.offset = copy.region.dstOffset;
+            barrier.size = copy.region.size;
+            bufferReleases.push_back(barrier);
+
+            barrier.srcAccessMask = 0;
+            barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+            batch.bufferAcquires.push_back(barrier);
+        }
+
+        std::vector<VkImageMemoryBarrier> imageReleases;
+        for (const auto &copy : pendingImageCopies) {
+            VkImageMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = 0;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            barrier.srcQueueFamilyIndex = transferFamily;
+            barrier.dstQueueFamilyIndex = graphicsFamily;
+            barrier.image = copy.dstImage;
+            barrier.subresourceRange = colorSubresourceRange(copy.region.imageSubresource.layerCount);
+            imageReleases.push_back(barrier);
+
+            barrier.srcAccessMask = 0;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            batch.imageAcquires.push_back(barrier);
+        }
+
+        vkCmdPipelineBarrier(
+                batch.commandBuffer,
+                VK_PIPELINE_STAGE_TRANSFER_BIT,
+                VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                0,
+                0, nullptr,
+                static_cast<uint32_t>(bufferReleases.size()), bufferReleases.data(),
+                static_cast<uint32_t>(imageReleases.size()), imageReleases.data());
+    }
+
+    void ChronosStagingRing::recordQueueAcquires(VkCommandBuffer graphicsCommandBuffer)
+    {
+        retireCompletedBatches(false);
+        if (!ownershipTransfer) {
+            return;
+        }
+
+        std::vector<VkBufferMemoryBarrier> bufferAcquires;
+        std::vector<VkImageMemoryBarrier> imageAcquires;
+        while (!awaitingAcquire.empty()) {
+            Batch &batch = awaitingAcquire.front();
+            bufferAcquires.insert(bufferAcquires.end(), batch.bufferAcquires.begin(), batch.bufferAcquires.end());
+            imageAcquires.insert(imageAcquires.end(), batch.imageAcquires.begin(), batch.imageAcquires.end());
+            lastAcquiredTicket = batch.ticket;
+            freeBatches.push_back(std::move(batch));
+            awaitingAcquire.pop_front();
+        }
+
+        if (bufferAcquires.empty() && imageAcquires.empty()) {
+            return;
+        }
+
+        vkCmdPipelineBarrier(
+                graphicsCommandBuffer,
+                VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                0,
+                0, nullptr,
+                static_cast<uint32_t>(bufferAcquires.size()), bufferAcquires.data(),
+                static_cast<uint32_t>(imageAcquires.size()), imageAcquires.data());
+    }
+
+    bool ChronosStagingRing::isReadyForGraphics(UploadTicket ticket)
+    {
+        if (!ownershipTransfer) {
+            // queue submission order plus the batch's trailing barrier cover it
+            return ticket <= lastSubmittedTicket;
+        }
+        return ticket <= lastAcquiredTicket;
+    }
+
+    bool ChronosStagingRing::isUploadComplete(UploadTicket ticket)
+    {
+        retireCompletedBatches(false);
+        return ticket <= lastCompletedTicket;
+    }
+
+    void ChronosStagingRing::waitForUpload(UploadTicket ticket)
+    {
+        if (ticket >= nextTicket) {
+            flush();
+        }
+        while (ticket > lastCompletedTicket && !inFlightBatches.empty()) {
+            retireCompletedBatches(true);
+        }
+    }
+
+    void ChronosStagingRing::waitIdle()
+    {
+        flush();
+        while (!inFlightBatches.empty()) {
+            retireCompletedBatches(true);
+        }
+    }
+
+    VkDeviceSize ChronosStagingRing::reserve(VkDeviceSize size)
+    {
+        assert(size <= capacity && "Staging reservation larger than the ring");
+
+        while (true) {
+            uint64_t start = (head + COPY_ALIGNMENT - 1) & ~(COPY_ALIGNMENT - 1);
+            // never let a reservation straddle the physical end of the ring
+            if (start % capacity + size > capacity) {
+                start += capacity - start % capacity;
+            }
+            if (start + size - tail <= capacity) {
+                head = start + size;
+                return start % capacity;
+            }
+
+            // out of space: push what we have so it can complete, then wait on the oldest batch
+            stats.stallCount++;
+            flush();
+            retireCompletedBatches(true);
+        }
+    }
+
+    void ChronosStagingRing::retireCompletedBatches(bool waitForOldest)
+    {
+        if (waitForOldest && !inFlightBatches.empty()) {
+            vkWaitForFences(
+                    chronosDevice.device(),
+                    1,
+                    &inFlightBatches.front().fence,
+                    VK_TRUE,
+                    std::numeric_limits<uint64_t>::max());
+        }
+
+        while (!inFlightBatches.empty() &&
+                vkGetFenceStatus(chronosDevice.device(), inFlightBatches.front().fence) == VK_SUCCESS) {
+            Batch &batch = inFlightBatches.front();
+            tail = batch.ringEnd;
+            lastCompletedTicket = batch.ticket;
+            if (ownershipTransfer) {
+                awaitingAcquire.push_back(std::move(batch));
+            } else {
+                freeBatches.push_back(std::move(batch));
+            }
+            inFlightBatches.pop_front();
+        }
+
+        if (inFlightBatches.empty() && pendingCopies.empty() && pendingImageCopies.empty()) {
+            head = 0;
+            tail = 0;
+        }
+    }
+
+    ChronosStagingRing::Batch ChronosStagingRing::acquireBatch()
+    {
+        if (!freeBatches.empty()) {
+            Batch batch = std::move(freeBatches.back());
+            freeBatches.pop_back();
+            vkResetFences(chronosDevice.device(), 1, &batch.fence);
+            vkResetCommandBuffer(batch.commandBuffer, 0);
+            return batch;
+        }
+
+        Batch batch{};
+
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandPool = commandPool;
+        allocInfo.commandBufferCount = 1;
+        if (vkAllocateCommandBuffers(chronosDevice.device(), &allocInfo, &batch.commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate staging command buffer!");
+        }
+
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        if (vkCreateFence(chronosDevice.device(), &fenceInfo, nullptr, &batch.fence) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create staging fence!");
+        }
+        return batch;
+    }
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "chronos_allocator.hpp"
+
+//std
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace Chronos {
+
+    class ChronosDevice;
+
+    // Persistently mapped host-visible ring that batches buffer and image uploads
+    // into a single submission per flush() on the device's transfer queue. Space
+    // is reclaimed as each batch's fence signals, so callers only ever wait when
+    // the ring is full.
+    //
+    // With a dedicated transfer family, every uploaded resource is released by the
+    // transfer queue and acquired on the graphics queue by recordQueueAcquires(),
+    // which the renderer calls at the top of each frame.
+    class ChronosStagingRing {
+    public:
+        static constexpr VkDeviceSize DEFAULT_CAPACITY = 64ull * 1024 * 1024;
+        static constexpr VkDeviceSize COPY_ALIGNMENT = 16;
+
+        // Identifies the batch an upload was placed in. Tickets complete in order.
+        using UploadTicket = uint64_t;
+
+        struct Stats {
+            uint64_t bytesUploaded = 0;
+            uint64_t copyCount = 0;
+            uint64_t submitCount = 0;
+            uint64_t stallCount = 0; // reservations that had to wait for a batch
+        };
+
+        ChronosStagingRing(ChronosDevice &device, VkDeviceSize capacity = DEFAULT_CAPACITY);
+        ~ChronosStagingRing();
+
+        ChronosStagingRing(const ChronosStagingRing &) = delete;
+        ChronosStagingRing &operator=(const ChronosStagingRing &) = delete;
+
+        // Copies `data` into the ring and queues a copy into dstBuffer. The copy
+        // is not submitted until flush().
+        UploadTicket uploadBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void *data, VkDeviceSize size);
+
+        // Uploads tightly packed texels into every layer of mip 0 and leaves the
+        // image in SHADER_READ_ONLY_OPTIMAL. The image must be in UNDEFINED layout.
+        UploadTicket uploadImage(
+                VkImage dstImage,
+                uint32_t width,
+                uint32_t height,
+                uint32_t layerCount,
+                const void *data,
+                VkDeviceSize size);
+
+        // Submits every queued copy in one command buffer. Returns immediately.
+        void flush();
+
+        // Records queue family acquire barriers for every batch that finished on the
+        // transfer queue. Must be recorded on the graphics queue, outside a render pass.
+        void recordQueueAcquires(VkCommandBuffer graphicsCommandBuffer);
+
+        // True once resources from `ticket` may be used by graphics work recorded
+        // after this call.
+        bool isReadyForGraphics(UploadTicket ticket);
+        bool isUploadComplete(UploadTicket ticket);
+        void waitForUpload(UploadTicket ticket);
+        void waitIdle();
+
+        const Stats &getStats() const { return stats; }
+
+    private:
+        struct PendingCopy {
+            VkBuffer dstBuffer;
+            VkBufferCopy region;
+        };
+
+        struct PendingImageCopy {
+            VkImage dstImage;
+            VkBufferImageCopy region;
+        };
+
+        struct Batch {
+            VkCommandBuffer commandBuffer;
+            VkFence fence;
+            uint64_t ringEnd;
+            UploadTicket ticket;
+            std::vector<VkBufferMemoryBarrier> bufferAcquires;
+            std::vector<VkImageMemoryBarrier> imageAcquires;
+        };
+
+        VkDeviceSize reserve(VkDeviceSize size);
+        void retireCompletedBatches(bool waitForOldest);
+        Batch acquireBatch();
+        void recordReleaseBarriers(Batch &batch);
+
+        ChronosDevice &chronosDevice;
+        VkDeviceSize capacity;
+        bool ownershipTransfer;
+        uint32_t transferFamily;
+        uint32_t graphicsFamily;
+
+        VkBuffer ringBuffer;
+        ChronosAllocation ringAllocation;
+        VkCommandPool commandPool;
+
+        // monotonically increasing positions, physical offset is position % capacity
+        uint64_t head = 0;
+        uint64_t tail = 0;
+
+        std::vector<PendingCopy> pendingCopies;
+        std::vector<PendingImageCopy> pendingImageCopies;
+        std::deque<Batch> inFlightBatches;
+        std::deque<Batch> awaitingAcquire;
+        std::vector<Batch> freeBatches;
+
+        UploadTicket nextTicket = 1;
+        UploadTicket lastSubmittedTicket = 0;
+        UploadTicket lastCompletedTicket = 0;
+        UploadTicket lastAcquiredTicket = 0;
+
+        Stats stats{};
+    };
+}
@@ -1,27 +1,41 @@
 #include "chronos_swap_chain.hpp"
 
 // std
+#include <algorithm>
 #include <array>
+#include <cassert>
 #include <cstdlib>
 #include <cstring>
-#include <iostream>
 #include <limits>
 #include <stdexcept>
 #include <vulkan/vulkan_core.h>
 
 namespace Chronos {
 
-ChronosSwapChain::ChronosSwapChain(ChronosDevice &deviceRef, VkExtent2D extent)
-    : device{deviceRef}, windowExtent{extent} 
+ChronosSwapChain::ChronosSwapChain(ChronosDevice &deviceRef, VkExtent2D extent, const ChronosPresentConfig &config)
+    : framesInFlight{config.framesInFlight},
+      preferredPresentMode{config.presentMode},
+      device{deviceRef},
+      windowExtent{extent}
 {
+    assert(framesInFlight >= 1 && framesInFlight <= MAX_FRAMES_IN_FLIGHT && "Frames in flight out of range");
     init();
 }
-ChronosSwapChain::ChronosSwapChain(ChronosDevice &deviceRef, VkExtent2D extent, std::shared_ptr<ChronosSwapChain> previous)
-    : device{deviceRef}, windowExtent{extent}, oldSwapChain{previous}
+ChronosSwapChain::ChronosSwapChain(
+    ChronosDevice &deviceRef,
+    VkExtent2D extent,
+    const ChronosPresentConfig &config,
+    std::shared_ptr<ChronosSwapChain> previous)
+    : framesInFlight{config.framesInFlight},
+      preferredPresentMode{config.presentMode},
+      device{deviceRef},
+      windowExtent{extent},
+      oldSwapChain{previous}
 {
+    assert(framesInFlight >= 1 && framesInFlight <= MAX_FRAMES_IN_FLIGHT && "Frames in flight out of range");
     init();
 
-    // clean up old swap chain since it's no longer needed
+    // the renderer keeps the old chain alive until its last frames have finished
     oldSwapChain = nullptr;
 }
 
@@ -48,8 +62,7 @@ ChronosSwapChain::~ChronosSwapChain() {
 
   for (int i = 0; i < depthImages.size(); i++) {
     vkDestroyImageView(device.device(), depthImageViews[i], nullptr);
-    vkDestroyImage(device.device(), depthImages[i], nullptr);
-    vkFreeMemory(device.device(), depthImageMemorys[i], nullptr);
+    device.destroyImage(depthImages[i], depthImageAllocations[i]);
   }
 
   for (auto framebuffer : swapChainFramebuffers) {
@@ -58,14 +71,23 @@ ChronosSwapChain::~ChronosSwapChain() {
 
   vkDestroyRenderPass(device.device(), renderPass, nullptr);
 
-  // cleanup synchronization objects
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+  // cleanup synchronization objects, unless handed on to a newer swap chain
+  for (size_t i = 0; i < inFlightFences.size(); i++) {
     vkDestroySemaphore(device.device(), renderFinishedSemaphores[i], nullptr);
     vkDestroySemaphore(device.device(), imageAvailableSemaphores[i], nullptr);
     vkDestroyFence(device.device(), inFlightFences[i], nullptr);
   }
 }
 
+void ChronosSwapChain::waitForFrame(size_t frameIndex) {
+  vkWaitForFences(
+      device.device(),
+      1,
+      &inFlightFences[frameIndex],
+      VK_TRUE,
+      std::numeric_limits<uint64_t>::max());
+}
+
 VkResult ChronosSwapChain::acquireNextImage(uint32_t *imageIndex) {
   vkWaitForFences(
       device.device(),
@@ -128,7 +150,7 @@ VkResult ChronosSwapChain::submitCommandBuffers(
 
   auto result = vkQueuePresentKHR(device.presentQueue(), &presentInfo);
 
-  currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+  currentFrame = (currentFrame + 1) % framesInFlight;
 
   return result;
 }
@@ -137,10 +159,12 @@ void ChronosSwapChain::createSwapChain() {
   SwapChainSupportDetails swapChainSupport = device.getSwapChainSupport();
 
   VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
-  VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
+  presentMode = chooseSwapPresentMode(preferredPresentMode, swapChainSupport.presentModes);
   VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
 
-  uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
+  // one image on screen, one queued and one per frame being recorded, so acquire
+  // never blocks on presentation before the fences throttle the CPU
+  uint32_t imageCount = std::max(swapChainSupport.capabilities.minImageCount + 1, framesInFlight + 1);
   if (swapChainSupport.capabilities.maxImageCount > 0 &&
       imageCount > swapChainSupport.capabilities.maxImageCount) {
     imageCount = swapChainSupport.capabilities.maxImageCount;
@@ -216,6 +240,14 @@ void ChronosSwapChain::createImageViews() {
 }
 
 void ChronosSwapChain::createRenderPass() {
+  // the render pass depends only on the formats, so a resize keeps it along with
+  // every pipeline built against it
+  if (oldSwapChain != nullptr && oldSwapChain->swapChainImageFormat == swapChainImageFormat) {
+    renderPass = oldSwapChain->renderPass;
+    oldSwapChain->renderPass = VK_NULL_HANDLE;
+    return;
+  }
+
   VkAttachmentDescription depthAttachment{};
   depthAttachment.format = findDepthFormat();
   depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
@@ -306,7 +338,7 @@ void ChronosSwapChain::createDepthResources() {
   VkExtent2D swapChainExtent = getSwapChainExtent();
 
   depthImages.resize(imageCount());
-  depthImageMemorys.resize(imageCount());
+  depthImageAllocations.resize(imageCount());
   depthImageViews.resize(imageCount());
 
   for (int i = 0; i < depthImages.size(); i++) {
@@ -330,7 +362,7 @@ void ChronosSwapChain::createDepthResources() {
         imageInfo,
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
         depthImages[i],
-        depthImageMemorys[i]);
+        depthImageAllocations[i]);
 
     VkImageViewCreateInfo viewInfo{};
     viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -350,11 +382,26 @@ void ChronosSwapChain::createDepthResources() {
 }
 
 void ChronosSwapChain::createSyncObjects() {
-  imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-  renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-  inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
   imagesInFlight.resize(imageCount(), VK_NULL_HANDLE);
 
+  // Frame slots carry on across recreation, so each fence keeps guarding the
+  // submission that last used its slot, whichever swap chain it went to.
+  if (oldSwapChain != nullptr) {
+    assert(oldSwapChain->framesInFlight == framesInFlight && "Frames in flight can't change on recreation");
+    imageAvailableSemaphores = std::move(oldSwapChain->imageAvailableSemaphores);
+    renderFinishedSemaphores = std::move(oldSwapChain->renderFinishedSemaphores);
+    inFlightFences = std::move(oldSwapChain->inFlightFences);
+    oldSwapChain->imageAvailableSemaphores.clear();
+    oldSwapChain->renderFinishedSemaphores.clear();
+    oldSwapChain->inFlightFences.clear();
+    currentFrame = oldSwapChain->currentFrame;
+    return;
+  }
+
+  imageAvailableSemaphores.resize(framesInFlight);
+  renderFinishedSemaphores.resize(framesInFlight);
+  inFlightFences.resize(framesInFlight);
+
   VkSemaphoreCreateInfo semaphoreInfo = {};
   semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
@@ -362,7 +409,7 @@ void ChronosSwapChain::createSyncObjects() {
   fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
   fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+  for (size_t i = 0; i < framesInFlight; i++) {
     if (vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) !=
             VK_SUCCESS ||
         vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) !=
@@ -386,25 +433,51 @@ VkSurfaceFormatKHR ChronosSwapChain::chooseSwapSurfaceFormat(
 }
 
 VkPresentModeKHR ChronosSwapChain::chooseSwapPresentMode(
+    VkPresentModeKHR preferredMode,
     const std::vector<VkPresentModeKHR> &availablePresentModes) {
-  for (const auto &availablePresentMode : availablePresentModes) {
-    if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
-      std::cout << "Present mode: Mailbox" << std::endl;
-      return availablePresentMode;
-    }
+  // Each mode falls back to the closest one with the same tearing behaviour first.
+  // FIFO is the only mode every surface must support.
+  std::vector<VkPresentModeKHR> candidates;
+  switch (preferredMode) {
+    case VK_PRESENT_MODE_IMMEDIATE_KHR:
+      candidates = {VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR, VK_PRESENT_MODE_MAILBOX_KHR};
+      break;
+    case VK_PRESENT_MODE_MAILBOX_KHR:
+      candidates = {VK_PRESENT_MODE_MAILBOX_KHR};
+      break;
+    case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+      candidates = {VK_PRESENT_MODE_FIFO_RELAXED_KHR};
+      break;
+    default:
+      break;
   }
 
-  // for (const auto &availablePresentMode : availablePresentModes) {
-  //   if (availablePresentMode == VK_PRESENT_MODE_IMMEDIATE_KHR) {
-  //     std::cout << "Present mode: Immediate" << std::endl;
-  //     return availablePresentMode;
-  //   }
-  // }
+  for (VkPresentModeKHR candidate : candidates) {
+    for (const auto &availablePresentMode : availablePresentModes) {
+      if (availablePresentMode == candidate) {
+        return candidate;
+      }
+    }
+  }
 
-  std::cout << "Present mode: V-Sync" << std::endl;
   return VK_PRESENT_MODE_FIFO_KHR;
 }
 
+const char *ChronosSwapChain::presentModeName(VkPresentModeKHR mode) {
+  switch (mode) {
+    case VK_PRESENT_MODE_IMMEDIATE_KHR:
+      return "Immediate";
+    case VK_PRESENT_MODE_MAILBOX_KHR:
+      return "Mailbox";
+    case VK_PRESENT_MODE_FIFO_KHR:
+      return "V-Sync";
+    case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+      return "Relaxed V-Sync";
+    default:
+      return "Unknown";
+  }
+}
+
 VkExtent2D ChronosSwapChain::chooseSwapExtent(const VkSurfaceCapabilitiesKHR &capabilities) {
   if (capabilities.currentExtent.width != std::numeric_limits<uint32_t>::max()) {
     return capabilities.currentExtent;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "chronos_device.hpp"
+#include "chronos_render_target.hpp"
 
 // vulkan headers
 #include <vulkan/vulkan.h>
@@ -12,21 +13,42 @@
 
 namespace Chronos {
 
-class ChronosSwapChain {
+struct ChronosPresentConfig {
+    // frames the CPU may record ahead of the GPU, 1 to ChronosSwapChain::MAX_FRAMES_IN_FLIGHT
+    uint32_t framesInFlight = 2;
+    // preferred mode; see ChronosSwapChain::chooseSwapPresentMode for the fallbacks
+    VkPresentModeKHR presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+    // wait for the GPU to finish the previous frame before input is sampled
+    bool lowLatency = false;
+};
+
+class ChronosSwapChain : public ChronosRenderTarget {
 public:
-    static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
+    static constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 4;
+
+    static const char *presentModeName(VkPresentModeKHR mode);
 
-    ChronosSwapChain(ChronosDevice &deviceRef, VkExtent2D windowExtent);
-    ChronosSwapChain(ChronosDevice &deviceRef, VkExtent2D windowExtent, std::shared_ptr<ChronosSwapChain> previous);
-    ~ChronosSwapChain();
+    ChronosSwapChain(ChronosDevice &deviceRef, VkExtent2D windowExtent, const ChronosPresentConfig &config);
+    ChronosSwapChain(
+        ChronosDevice &deviceRef,
+        VkExtent2D windowExtent,
+        const ChronosPresentConfig &config,
+        std::shared_ptr<ChronosSwapChain> previous);
+    ~ChronosSwapChain() override;
 
     ChronosSwapChain(const ChronosSwapChain &) = delete;
     ChronosSwapChain& operator=(const ChronosSwapChain &) = delete;
 
-    VkFramebuffer getFrameBuffer(int index) { return swapChainFramebuffers[index]; }
-    VkRenderPass getRenderPass() { return renderPass; }
+    VkFramebuffer getFrameBuffer(int index) override { return swapChainFramebuffers[index]; }
+    VkRenderPass getRenderPass() override { return renderPass; }
+    VkExtent2D getExtent() override { return swapChainExtent; }
     VkImageView getImageView(int index) { return swapChainImageViews[index]; }
     size_t imageCount() { return swapChainImages.size(); }
+    size_t getCurrentFrame() override { return currentFrame; }
+    size_t getPreviousFrame() override { return (currentFrame + framesInFlight - 1) % framesInFlight; }
+    uint32_t getFramesInFlight() override { return framesInFlight; }
+    // the mode actually in use, after fallbacks
+    VkPresentModeKHR getPresentMode() { return presentMode; }
     VkFormat getSwapChainImageFormat() { return swapChainImageFormat; }
     VkExtent2D getSwapChainExtent() { return swapChainExtent; }
     uint32_t width() { return swapChainExtent.width; }
@@ -37,8 +59,9 @@ public:
     }
     VkFormat findDepthFormat();
 
-    VkResult acquireNextImage(uint32_t *imageIndex);
-    VkResult submitCommandBuffers(const VkCommandBuffer *buffers, uint32_t *imageIndex);
+    void waitForFrame(size_t frameIndex) override;
+    VkResult acquireNextImage(uint32_t *imageIndex) override;
+    VkResult submitCommandBuffers(const VkCommandBuffer *buffers, uint32_t *imageIndex) override;
 
 private:
     void init();
@@ -53,10 +76,14 @@ private:
     VkSurfaceFormatKHR chooseSwapSurfaceFormat(
         const std::vector<VkSurfaceFormatKHR> &availableFormats);
     VkPresentModeKHR chooseSwapPresentMode(
+        VkPresentModeKHR preferredMode,
         const std::vector<VkPresentModeKHR> &availablePresentModes);
     VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR &capabilities);
 
 private:
+    uint32_t framesInFlight;
+    VkPresentModeKHR preferredPresentMode;
+    VkPresentModeKHR presentMode;
     VkFormat swapChainImageFormat;
     VkExtent2D swapChainExtent;
 
@@ -64,7 +91,7 @@ private:
     VkRenderPass renderPass;
 
     std::vector<VkImage> depthImages;
-    std::vector<VkDeviceMemory> depthImageMemorys;
+    std::vector<ChronosAllocation> depthImageAllocations;
     std::vector<VkImageView> depthImageViews;
     std::vector<VkImage> swapChainImages;
     std::vector<VkImageView> swapChainImageViews;
@@ -0,0 +1,166 @@
+#include "chronos_transform_batch.hpp"
+
+//std
+#include <cassert>
+#include <cstddef>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define CHRONOS_X86_64 1
+#include <emmintrin.h>
+#include "chronos_simd_sincos.hpp"
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+namespace Chronos {
+
+    // chronos_transform_batch_avx2.cpp, built with AVX2/FMA code generation
+    bool avx2TransformKernelCompiled();
+    void computeTransformMatricesAvx2(const Transform2dComponent *transforms, glm::mat2 *outMatrices, size_t count);
+
+    static_assert(sizeof(Transform2dComponent) == 5 * sizeof(float), "kernels assume a tightly packed component");
+    static_assert(sizeof(glm::mat2) == 4 * sizeof(float), "kernels store column-major mat2 as four floats");
+
+    namespace {
+        void computeTransformMatricesScalar(
+                const Transform2dComponent *transforms, glm::mat2 *outMatrices, size_t count)
+        {
+            for (size_t i = 0; i < count; i++) {
+                outMatrices[i] = transforms[i].mat2();
+            }
+        }
+
+#ifdef CHRONOS_X86_64
+        struct Sse2Ops {
+            using F = __m128;
+            using I = __m128i;
+
+            static F set1(float v) { return _mm_set1_ps(v); }
+            static I set1i(int v) { return _mm_set1_epi32(v); }
+            static F add(F a, F b) { return _mm_add_ps(a, b); }
+            static F mul(F a, F b) { return _mm_mul_ps(a, b); }
+            static F mulAdd(F a, F b, F c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+            static F andBits(F a, F b) { return _mm_and_ps(a, b); }
+            static F andNotBits(F a, F b) { return _mm_andnot_ps(a, b); }
+            static F orBits(F a, F b) { return _mm_or_ps(a, b); }
+            static F xorBits(F a, F b) { return _mm_xor_ps(a, b); }
+            static I truncateToInt(F a) { return _mm_cvttps_epi32(a); }
+            static F toFloat(I a) { return _mm_cvtepi32_ps(a); }
+            static I addi(I a, I b) { return _mm_add_epi32(a, b); }
+            static I subi(I a, I b) { return _mm_sub_epi32(a, b); }
+            static I andi(I a, I b) { return _mm_and_si128(a, b); }
+            static I andNoti(I a, I b) { return _mm_andnot_si128(a, b); }
+            static I equali(I a, I b) { return _mm_cmpeq_epi32(a, b); }
+            static I shiftLeft29(I a) { return _mm_slli_epi32(a, 29); }
+            static F castToFloat(I a) { return _mm_castsi128_ps(a); }
+        };
+
+        void computeTransformMatricesSse2(
+                const Transform2dComponent *transforms, glm::mat2 *outMatrices, size_t count)
+        {
+            size_t i = 0;
+            for (; i + 4 <= count; i += 4) {
+                const Transform2dComponent *t = transforms + i;
+                __m128 rotation = _mm_setr_ps(t[0].rotation, t[1].rotation, t[2].rotation, t[3].rotation);
+                __m128 scaleX = _mm_setr_ps(t[0].scale.x, t[1].scale.x, t[2].scale.x, t[3].scale.x);
+                __m128 scaleY = _mm_setr_ps(t[0].scale.y, t[1].scale.y, t[2].scale.y, t[3].scale.y);
+
+                __m128 s, c;
+                simdSinCos<Sse2Ops>(rotation, s, c);
+
+                // columns of rotation * scale: (c*sx, s*sx), (-s*sy, c*sy)
+                __m128 m00 = _mm_mul_ps(c, scaleX);
+                __m128 m01 = _mm_mul_ps(s, scaleX);
+                __m128 m10 = _mm_xor_ps(_mm_mul_ps(s, scaleY), _mm_set1_ps(-0.f));
+                __m128 m11 = _mm_mul_ps(c, scaleY);
+                _MM_TRANSPOSE4_PS(m00, m01, m10, m11);
+
+                float *out = reinterpret_cast<float *>(outMatrices + i);
+                _mm_storeu_ps(out, m00);
+                _mm_storeu_ps(out + 4, m01);
+                _mm_storeu_ps(out + 8, m10);
+                _mm_storeu_ps(out + 12, m11);
+            }
+            computeTransformMatricesScalar(transforms + i, outMatrices + i, count - i);
+        }
+#endif
+
+        bool cpuSupportsAvx2()
+        {
+#if defined(CHRONOS_X86_64) && (defined(__GNUC__) || defined(__clang__))
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#elif defined(CHRONOS_X86_64) && defined(_MSC_VER)
+            int info[4];
+            __cpuid(info, 1);
+            bool osxsave = (info[2] & (1 << 27)) != 0;
+            bool fma = (info[2] & (1 << 12)) != 0;
+            // the OS must save YMM state across context switches
+            if (!osxsave || !fma || (_xgetbv(0) & 0x6) != 0x6) {
+                return false;
+            }
+            __cpuidex(info, 7, 0);
+            return (info[1] & (1 << 5)) != 0;
+#else
+            return false;
+#endif
+        }
+    }
+
+    ChronosSimdLevel detectSimdLevel()
+    {
+        static const ChronosSimdLevel level = []() {
+#ifdef CHRONOS_X86_64
+            if (avx2TransformKernelCompiled() && cpuSupportsAvx2()) {
+                return ChronosSimdLevel::AVX2;
+            }
+            // SSE2 is part of the x86-64 baseline
+            return ChronosSimdLevel::SSE2;
+#else
+            return ChronosSimdLevel::Scalar;
+#endif
+        }();
+        return level;
+    }
+
+    const char *simdLevelName(ChronosSimdLevel level)
+    {
+        switch (level) {
+            case ChronosSimdLevel::Scalar: return "scalar";
+            case ChronosSimdLevel::SSE2: return "SSE2";
+            case ChronosSimdLevel::AVX2: return "AVX2";
+        }
+        return "unknown";
+    }
+
+    void computeTransformMatrices(const Transform2dComponent *transforms, glm::mat2 *outMatrices, size_t count)
+    {
+        computeTransformMatrices(detectSimdLevel(), transforms, outMatrices, count);
+    }
+
+    void computeTransformMatrices(
+            ChronosSimdLevel level,
+            const Transform2dComponent *transforms,
+            glm::mat2 *outMatrices,
+            size_t count)
+    {
+        if (static_cast<int>(level) > static_cast<int>(detectSimdLevel())) {
+            level = detectSimdLevel();
+        }
+
+        switch (level) {
+#ifdef CHRONOS_X86_64
+            case ChronosSimdLevel::AVX2:
+                computeTransformMatricesAvx2(transforms, outMatrices, count);
+                return;
+            case ChronosSimdLevel::SSE2:
+                computeTransformMatricesSse2(transforms, outMatrices, count);
+                return;
+#endif
+            default:
+                computeTransformMatricesScalar(transforms, outMatrices, count);
+                return;
+        }
+    }
+}
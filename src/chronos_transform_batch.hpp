@@ -0,0 +1,30 @@
+#pragma once
+
+#include "chronos_components.hpp"
+
+//std
+#include <cstddef>
+
+namespace Chronos {
+
+    enum class ChronosSimdLevel {
+        Scalar,
+        SSE2,
+        AVX2,
+    };
+
+    // Highest level supported by both the build and the running CPU. Detected once.
+    ChronosSimdLevel detectSimdLevel();
+    const char *simdLevelName(ChronosSimdLevel level);
+
+    // Writes transforms[i].mat2() to outMatrices[i] for a contiguous array, using the
+    // widest kernel the CPU supports. The SIMD kernels use a polynomial sincos
+    // accurate to a few ulp for |rotation| below ~8192 radians.
+    void computeTransformMatrices(const Transform2dComponent *transforms, glm::mat2 *outMatrices, size_t count);
+    // Same, pinned to one kernel. Levels the CPU lacks fall back to the detected level.
+    void computeTransformMatrices(
+            ChronosSimdLevel level,
+            const Transform2dComponent *transforms,
+            glm::mat2 *outMatrices,
+            size_t count);
+}
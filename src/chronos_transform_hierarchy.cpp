@@ -0,0 +1,213 @@
+#include "chronos_transform_hierarchy.hpp"
+#include "chronos_transform_batch.hpp"
+
+//std
+#include <algorithm>
+#include <stdexcept>
+
+namespace Chronos {
+
+    void ChronosTransformHierarchy::update(ChronosRegistry &registry)
+    {
+        auto &transforms = registry.pool<Transform2dComponent>();
+        rebuilt = false;
+        if (needsRebuild(registry)) {
+            rebuild(registry);
+        }
+
+        // has to read the dirty list before propagation adds descendants to it
+        updateLocalMatrices(transforms);
+
+        if (rebuilt || transforms.getDirtyIndices().size() * FULL_UPDATE_RATIO >= transforms.size()) {
+            propagateAll(transforms);
+        } else {
+            propagateDirty(transforms);
+        }
+    }
+
+    bool ChronosTransformHierarchy::needsRebuild(ChronosRegistry &registry) const
+    {
+        auto &parents = registry.pool<ParentComponent>();
+        return registry.pool<Transform2dComponent>().getStructureVersion() != builtTransformVersion ||
+               parents.getStructureVersion() != builtParentVersion || !parents.getDirtyIndices().empty();
+    }
+
+    void ChronosTransformHierarchy::rebuild(ChronosRegistry &registry)
+    {
+        auto &transforms = registry.pool<Transform2dComponent>();
+        auto &parents = registry.pool<ParentComponent>();
+        // a failed build leaves the arrays half-filled, so it must be redone next update
+        builtTransformVersion = UINT64_MAX;
+        builtParentVersion = UINT64_MAX;
+
+        // parent of each transform; a parent without a transform makes the child a root
+        const size_t count = transforms.size();
+        std::vector<uint32_t> parentTransforms(count, NO_PARENT);
+        for (size_t i = 0; i < count; i++) {
+            ParentComponent *parent = parents.find(transforms.entityAt(i));
+            if (!parent) continue;
+            if (Transform2dComponent *parentTransform = transforms.find(parent->parent)) {
+                parentTransforms[i] = static_cast<uint32_t>(transforms.indexOf(*parentTransform));
+            }
+        }
+
+        // children of every transform, grouped by counting sort
+        std::vector<uint32_t> childOffsets(count + 1, 0);
+        for (uint32_t parent : parentTransforms) {
+            if (parent != NO_PARENT) childOffsets[parent + 1]++;
+        }
+        for (size_t i = 0; i < count; i++) {
+            childOffsets[i + 1] += childOffsets[i];
+        }
+        std::vector<uint32_t> children(childOffsets[count]);
+        std::vector<uint32_t> fillOffsets(childOffsets.begin(), childOffsets.end() - 1);
+        for (size_t i = 0; i < count; i++) {
+            if (parentTransforms[i] != NO_PARENT) {
+                children[fillOffsets[parentTransforms[i]]++] = static_cast<uint32_t>(i);
+            }
+        }
+
+        nodeParents.clear();
+        nodeTransforms.clear();
+        nodeParents.reserve(count);
+        nodeTransforms.reserve(count);
+        firstChildren.assign(count, 0);
+        childCounts.assign(count, 0);
+        nodeByTransform.assign(count, NO_PARENT);
+
+        auto appendNode = [&](uint32_t transformIndex, uint32_t parentNode) {
+            nodeByTransform[transformIndex] = static_cast<uint32_t>(nodeTransforms.size());
+            nodeTransforms.push_back(transformIndex);
+            nodeParents.push_back(parentNode);
+        };
+
+        for (size_t i = 0; i < count; i++) {
+            if (parentTransforms[i] == NO_PARENT) appendNode(static_cast<uint32_t>(i), NO_PARENT);
+        }
+        levelOffsets.assign({0, nodeTransforms.size()});
+        for (size_t level = 0; levelOffsets[level] < levelOffsets[level + 1]; level++) {
+            for (size_t node = levelOffsets[level]; node < levelOffsets[level + 1]; node++) {
+                uint32_t transformIndex = nodeTransforms[node];
+                firstChildren[node] = static_cast<uint32_t>(nodeTransforms.size());
+                childCounts[node] = childOffsets[transformIndex + 1] - childOffsets[transformIndex];
+                for (uint32_t c = childOffsets[transformIndex]; c < childOffsets[transformIndex + 1]; c++) {
+                    appendNode(children[c], static_cast<uint32_t>(node));
+                }
+            }
+            levelOffsets.push_back(nodeTransforms.size());
+        }
+        // the loop stops on the empty level it just appended
+        levelOffsets.pop_back();
+
+        if (nodeTransforms.size() != count) {
+            throw std::runtime_error("transform hierarchy contains a cycle!");
+        }
+
+        worldMatrices.resize(count);
+        worldOffsets.resize(count);
+        visitStamps.assign(count, 0);
+        visitStamp = 0;
+
+        builtTransformVersion = transforms.getStructureVersion();
+        builtParentVersion = parents.getStructureVersion();
+        rebuilt = true;
+    }
+
+    void ChronosTransformHierarchy::updateLocalMatrices(ChronosComponentPool<Transform2dComponent> &transforms)
+    {
+        const size_t count = transforms.size();
+        localMatrices.resize(count);
+
+        // scattered scalar updates only pay off while few transforms changed
+        const auto &dirty = transforms.getDirtyIndices();
+        if (rebuilt || dirty.size() * FULL_UPDATE_RATIO >= count) {
+            const Transform2dComponent *data = transforms.data();
+            glm::mat2 *out = localMatrices.data();
+            RangeFunction body = [data, out](size_t begin, size_t end) {
+                computeTransformMatrices(data + begin, out + begin, end - begin);
+            };
+            if (parallelFor && count > LEVEL_GRAIN_SIZE) {
+                parallelFor(0, count, LEVEL_GRAIN_SIZE, body);
+            } else {
+                body(0, count);
+            }
+            return;
+        }
+        for (uint32_t index : dirty) {
+            if (index < count) {
+                localMatrices[index] = transforms.componentAt(index).mat2();
+            }
+        }
+    }
+
+    void ChronosTransformHierarchy::propagateAll(ChronosComponentPool<Transform2dComponent> &transforms)
+    {
+        const Transform2dComponent *data = transforms.data();
+        RangeFunction body = [this, data](size_t begin, size_t end) {
+            for (size_t node = begin; node < end; node++) {
+                computeNode(static_cast<uint32_t>(node), data);
+            }
+        };
+        // a level only reads the one above it, which is complete once parallelFor returns
+        for (size_t level = 0; level < levelCount(); level++) {
+            size_t begin = levelOffsets[level];
+            size_t end = levelOffsets[level + 1];
+            if (parallelFor && end - begin > LEVEL_GRAIN_SIZE) {
+                parallelFor(begin, end, LEVEL_GRAIN_SIZE, body);
+            } else {
+                body(begin, end);
+            }
+        }
+        transforms.markAllDirty();
+    }
+
+    void ChronosTransformHierarchy::propagateDirty(ChronosComponentPool<Transform2dComponent> &transforms)
+    {
+        dirtyNodes.clear();
+        for (uint32_t index : transforms.getDirtyIndices()) {
+            if (index < transforms.size()) dirtyNodes.push_back(nodeByTransform[index]);
+        }
+        // breadth-first order puts ancestors first, so their walks claim nested dirty nodes
+        std::sort(dirtyNodes.begin(), dirtyNodes.end());
+
+        if (++visitStamp == 0) {
+            std::fill(visitStamps.begin(), visitStamps.end(), 0);
+            visitStamp = 1;
+        }
+
+        const Transform2dComponent *data = transforms.data();
+        for (uint32_t root : dirtyNodes) {
+            if (visitStamps[root] == visitStamp) continue;
+
+            subtreeQueue.clear();
+            subtreeQueue.push_back(root);
+            for (size_t i = 0; i < subtreeQueue.size(); i++) {
+                uint32_t node = subtreeQueue[i];
+                visitStamps[node] = visitStamp;
+                computeNode(node, data);
+                if (i > 0) {
+                    transforms.markDirty(transforms.entityAt(nodeTransforms[node]));
+                }
+                for (uint32_t child = firstChildren[node]; child < firstChildren[node] + childCounts[node]; child++) {
+                    subtreeQueue.push_back(child);
+                }
+            }
+        }
+    }
+
+    void ChronosTransformHierarchy::computeNode(uint32_t node, const Transform2dComponent *transforms)
+    {
+        uint32_t transformIndex = nodeTransforms[node];
+        const glm::mat2 &local = localMatrices[transformIndex];
+        const glm::vec2 &translation = transforms[transformIndex].translation;
+
+        uint32_t parent = nodeParents[node];
+        if (parent == NO_PARENT) {
+            worldMatrices[node] = local;
+            worldOffsets[node] = translation;
+        } else {
+            worldMatrices[node] = worldMatrices[parent] * local;
+            worldOffsets[node] = worldMatrices[parent] * translation + worldOffsets[parent];
+        }
+    }
+}
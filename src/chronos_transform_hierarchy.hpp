@@ -0,0 +1,95 @@
+#pragma once
+
+#include "chronos_components.hpp"
+#include "chronos_ecs.hpp"
+
+//std
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace Chronos {
+
+    // World transforms for every Transform2dComponent, following ParentComponent links.
+    //
+    // Nodes are stored breadth-first in flat arrays, so every parent precedes its
+    // children, each depth level is one contiguous range, and the children of a node
+    // are contiguous too. A full update is a single linear pass, with each level split
+    // across workers by the pluggable parallel-for. When only a few transforms changed,
+    // just the dirty subtrees are re-propagated.
+    //
+    // Every transform whose world value changed is marked dirty in the transform pool,
+    // so incremental consumers such as ChronosGpuCulling see moved descendants too.
+    class ChronosTransformHierarchy {
+    public:
+        static constexpr uint32_t NO_PARENT = UINT32_MAX;
+        // fall back to a full pass once 1/N of the transforms changed
+        static constexpr size_t FULL_UPDATE_RATIO = 8;
+        // nodes per parallel-for task; smaller levels run inline
+        static constexpr size_t LEVEL_GRAIN_SIZE = 4096;
+
+        // body(begin, end) must be called over disjoint ranges covering [begin, end),
+        // and the call must not return before every range has finished.
+        using RangeFunction = std::function<void(size_t begin, size_t end)>;
+        using ParallelFor = std::function<void(size_t begin, size_t end, size_t grainSize, const RangeFunction &body)>;
+
+        ChronosTransformHierarchy() = default;
+
+        ChronosTransformHierarchy(const ChronosTransformHierarchy &) = delete;
+        ChronosTransformHierarchy &operator=(const ChronosTransformHierarchy &) = delete;
+
+        // Runs levels serially when unset.
+        void setParallelFor(ParallelFor parallelFor) { this->parallelFor = std::move(parallelFor); }
+
+        // Call once per frame, after gameplay changes and before the registry's
+        // dirty lists are consumed and cleared. Throws on a parent cycle, and again
+        // on every later update until the cycle is broken.
+        void update(ChronosRegistry &registry);
+
+        // world transform of the transform at this dense index of the Transform2dComponent pool
+        const glm::mat2 &worldMatrix(size_t transformIndex) const
+        {
+            return worldMatrices[nodeByTransform[transformIndex]];
+        }
+        const glm::vec2 &worldOffset(size_t transformIndex) const
+        {
+            return worldOffsets[nodeByTransform[transformIndex]];
+        }
+
+        size_t size() const { return nodeParents.size(); }
+        size_t levelCount() const { return levelOffsets.empty() ? 0 : levelOffsets.size() - 1; }
+
+    private:
+        bool needsRebuild(ChronosRegistry &registry) const;
+        void rebuild(ChronosRegistry &registry);
+        void updateLocalMatrices(ChronosComponentPool<Transform2dComponent> &transforms);
+        void propagateAll(ChronosComponentPool<Transform2dComponent> &transforms);
+        void propagateDirty(ChronosComponentPool<Transform2dComponent> &transforms);
+        void computeNode(uint32_t node, const Transform2dComponent *transforms);
+
+        ParallelFor parallelFor;
+
+        // local mat2() of each transform, in the transform pool's dense order
+        std::vector<glm::mat2> localMatrices;
+
+        // breadth-first node arrays
+        std::vector<uint32_t> nodeParents;
+        std::vector<uint32_t> nodeTransforms; // node -> transform dense index
+        std::vector<uint32_t> firstChildren;
+        std::vector<uint32_t> childCounts;
+        std::vector<size_t> levelOffsets; // level i is [levelOffsets[i], levelOffsets[i + 1])
+        std::vector<glm::mat2> worldMatrices;
+        std::vector<glm::vec2> worldOffsets;
+        std::vector<uint32_t> nodeByTransform;
+
+        uint64_t builtTransformVersion = UINT64_MAX;
+        uint64_t builtParentVersion = UINT64_MAX;
+        bool rebuilt = false;
+
+        std::vector<uint32_t> dirtyNodes;
+        std::vector<uint32_t> visitStamps;
+        std::vector<uint32_t> subtreeQueue;
+        uint32_t visitStamp = 0;
+    };
+}
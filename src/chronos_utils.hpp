@@ -0,0 +1,32 @@
+#pragma once
+
+//std
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <system_error>
+
+namespace Chronos {
+
+    // from: https://stackoverflow.com/a/57595105
+    template <typename T, typename... Rest>
+    void hashCombine(std::size_t &seed, const T &v, const Rest &... rest)
+    {
+        seed ^= std::hash<T>{}(v) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        (hashCombine(seed, rest), ...);
+    }
+
+    // Moves a fully written tempPath over path, so readers see either the old file or
+    // the new one, never a partial write. Replaces an existing path on every platform,
+    // unlike std::rename on Windows. On failure tempPath is removed.
+    inline std::error_code replaceFile(const std::string &tempPath, const std::string &path)
+    {
+        std::error_code error;
+        std::filesystem::rename(tempPath, path, error);
+        if (error) {
+            std::error_code ignored;
+            std::filesystem::remove(tempPath, ignored);
+        }
+        return error;
+    }
+}
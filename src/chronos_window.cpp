@@ -24,6 +24,7 @@ namespace Chronos {
         window = glfwCreateWindow(width, height, windowName.c_str(), nullptr, nullptr);
         glfwSetWindowUserPointer(window, this);
         glfwSetFramebufferSizeCallback(window, framebufferResizeCallback);
+        glfwSetWindowRefreshCallback(window, windowRefreshCallback);
     }
 
     void ChronosWindow::createWindowSurface(VkInstance instance, VkSurfaceKHR *surface)
@@ -40,4 +41,12 @@ namespace Chronos {
         chronosWindow->width = width;
         chronosWindow->height = height;
     }
+
+    void ChronosWindow::windowRefreshCallback(GLFWwindow *window)
+    {
+        auto chronosWindow = reinterpret_cast<ChronosWindow *>(glfwGetWindowUserPointer(window));
+        if (chronosWindow->refreshCallback) {
+            chronosWindow->refreshCallback();
+        }
+    }
 }
@@ -4,6 +4,7 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
+#include <functional>
 #include <string>
 
 namespace Chronos {
@@ -22,13 +23,19 @@ namespace Chronos {
 
         void createWindowSurface(VkInstance instance, VkSurfaceKHR *surface);
 
+        // Called when the window contents need redrawing, including from inside
+        // event processing while the window is being resized.
+        void setRefreshCallback(std::function<void()> callback) { refreshCallback = std::move(callback); }
+
     private:
         static void framebufferResizeCallback(GLFWwindow *window, int width, int height);
+        static void windowRefreshCallback(GLFWwindow *window);
         void initWindow();
 
         int width;
         int height;
         bool framebufferResized = false;
+        std::function<void()> refreshCallback;
 
         std::string windowName;
         GLFWwindow *window;
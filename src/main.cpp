@@ -4,12 +4,60 @@
 #include <cstdlib>
 #include <iostream>
 #include <stdexcept>
+#include <string>
 
-int main() 
+//   ChronosEngine [--present immediate|mailbox|fifo|fifo_relaxed] [--low-latency]
+//                 [--frames-in-flight N] [--stats] [--cycle-present-modes] [--hot-reload]
+
+namespace {
+
+VkPresentModeKHR parsePresentMode(const std::string &name)
+{
+    if (name == "immediate") return VK_PRESENT_MODE_IMMEDIATE_KHR;
+    if (name == "mailbox") return VK_PRESENT_MODE_MAILBOX_KHR;
+    if (name == "fifo") return VK_PRESENT_MODE_FIFO_KHR;
+    if (name == "fifo_relaxed") return VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+    throw std::runtime_error("unknown present mode " + name + "!");
+}
+
+Chronos::ChronosApp::Settings parseSettings(int argc, char **argv)
 {
-    Chronos::ChronosApp app{};
+    Chronos::ChronosApp::Settings settings{};
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--low-latency") {
+            settings.presentConfig.lowLatency = true;
+        } else if (arg == "--stats") {
+            settings.printStats = true;
+        } else if (arg == "--hot-reload") {
+            settings.hotReloadShaders = true;
+        } else if (arg == "--cycle-present-modes") {
+            // stats are what the modes are compared by
+            settings.printStats = true;
+            settings.cyclePresentModes = true;
+        } else if (i + 1 >= argc) {
+            throw std::runtime_error("unknown option or missing value for " + arg + "!");
+        } else if (arg == "--present") {
+            settings.presentConfig.presentMode = parsePresentMode(argv[++i]);
+        } else if (arg == "--frames-in-flight") {
+            settings.presentConfig.framesInFlight = static_cast<uint32_t>(std::stoul(argv[++i]));
+            if (settings.presentConfig.framesInFlight < 1 ||
+                settings.presentConfig.framesInFlight > Chronos::ChronosSwapChain::MAX_FRAMES_IN_FLIGHT) {
+                throw std::runtime_error("--frames-in-flight out of range!");
+            }
+        } else {
+            throw std::runtime_error("unknown option " + arg + "!");
+        }
+    }
+    return settings;
+}
 
+}
+
+int main(int argc, char **argv)
+{
     try {
+        Chronos::ChronosApp app{parseSettings(argc, argv)};
         app.run();
     } catch (const std::exception &e) {
         std::cerr << e.what() << '\n';
@@ -0,0 +1,17 @@
+#version 450
+
+layout(location = 0) in vec2 position;
+layout(location = 1) in vec3 color;
+
+// per-instance, binding 1
+layout(location = 2) in mat2 instanceTransform;
+layout(location = 4) in vec2 instanceOffset;
+layout(location = 5) in vec3 instanceColor;
+
+layout(location = 0) out vec3 fragColor;
+
+void main()
+{
+    gl_Position = vec4(instanceTransform * position + instanceOffset, 0.0, 1.0);
+    fragColor = instanceColor;
+}